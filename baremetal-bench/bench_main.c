@@ -0,0 +1,241 @@
+// bench_main.c - Bare-metal cycle counts for the predictor hot path
+//
+// Runs the predictor core from predictive-cpufreq over embedded traces with
+// interrupts disabled and nothing else on the machine, timing each call with
+// a serialized rdtsc. Results go to COM1; the run ends by writing to QEMU's
+// isa-debug-exit port.
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include "predictive_model.h"
+#include "bench_traces.h"
+
+#define SERIAL_PORT 0x3F8
+#define DEBUG_EXIT_PORT 0xF4
+#define BENCH_ITERATIONS 1024
+#define SAMPLE_PERIOD_NS 50000000u  // Matches the governor's default sample_rate_ms
+
+struct bench_trace {
+    const char *name;
+    const struct bench_sample *samples;
+    u32 count;
+};
+
+static const struct bench_trace traces[] = {
+    { "periodic", trace_periodic, ARRAY_SIZE(trace_periodic) },
+    { "bursty", trace_bursty, ARRAY_SIZE(trace_bursty) },
+    { "io", trace_io, ARRAY_SIZE(trace_io) },
+};
+
+static prediction_model_t model;
+static u32 cycles[BENCH_ITERATIONS];
+static u32 tsc_overhead;
+static u32 irq_total;
+static volatile u32 sink;
+
+static void outb(u16 port, u8 val) {
+    __asm__ __volatile__("outb %0, %1" : : "a"(val), "Nd"(port));
+}
+static u8 inb(u16 port) {
+    u8 ret;
+    __asm__ __volatile__("inb %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
+static void serial_init(void) {
+    outb(SERIAL_PORT + 1, 0x00);
+    outb(SERIAL_PORT + 3, 0x80);
+    outb(SERIAL_PORT + 0, 0x03);
+    outb(SERIAL_PORT + 1, 0x00);
+    outb(SERIAL_PORT + 3, 0x03);
+    outb(SERIAL_PORT + 2, 0xC7);
+    outb(SERIAL_PORT + 4, 0x0B);
+}
+static void serial_write(char c) {
+    while (!(inb(SERIAL_PORT + 5) & 0x20));
+    outb(SERIAL_PORT, c);
+}
+static void serial_print(const char *s) {
+    while (*s) serial_write(*s++);
+}
+static void itoa(unsigned int n, char *buf, int base) {
+    char tmp[32]; int i = 0, j = 0;
+    if (n == 0) { buf[0] = '0'; buf[1] = 0; return; }
+    while (n) { tmp[i++] = "0123456789ABCDEF"[n % base]; n /= base; }
+    while (i--) buf[j++] = tmp[i];
+    buf[j] = 0;
+}
+static void serial_print_u32(u32 n) {
+    char buf[16];
+    itoa(n, buf, 10);
+    serial_print(buf);
+}
+static void cpuid(unsigned int op, unsigned int *eax, unsigned int *ebx, unsigned int *ecx, unsigned int *edx) {
+    __asm__ __volatile__(
+        "cpuid"
+        : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+        : "0"(op)
+    );
+}
+
+// The predictor core and gcc's struct copies need these
+void *memset(void *s, int c, size_t n) {
+    u8 *p = s;
+    while (n--) *p++ = (u8)c;
+    return s;
+}
+void *memcpy(void *dest, const void *src, size_t n) {
+    u8 *d = dest;
+    const u8 *s = src;
+    while (n--) *d++ = *s++;
+    return dest;
+}
+
+// cpuid keeps earlier instructions from drifting past rdtsc
+static inline u64 tsc_read(void) {
+    unsigned int eax, ebx, ecx, edx;
+    u32 lo, hi;
+    cpuid(0, &eax, &ebx, &ecx, &edx);
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((u64)hi << 32) | lo;
+}
+
+static u32 tsc_delta(u64 start) {
+    u32 delta = (u32)(tsc_read() - start);
+    return delta > tsc_overhead ? delta - tsc_overhead : 0;
+}
+
+static void calibrate_tsc(void) {
+    u32 best = 0xFFFFFFFFu;
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        u64 start = tsc_read();
+        u32 delta = (u32)(tsc_read() - start);
+        if (delta < best)
+            best = delta;
+    }
+    tsc_overhead = best;
+}
+
+static void sort_cycles(u32 *v, int n) {
+    for (int i = 1; i < n; i++) {
+        u32 key = v[i];
+        int j = i - 1;
+        while (j >= 0 && v[j] > key) {
+            v[j + 1] = v[j];
+            j--;
+        }
+        v[j + 1] = key;
+    }
+}
+
+static void report(const char *func, const struct bench_trace *t, int n) {
+    sort_cycles(cycles, n);
+    serial_print(func);
+    serial_print(" ["); serial_print(t->name); serial_print("]");
+    serial_print(" min "); serial_print_u32(cycles[0]);
+    serial_print(" median "); serial_print_u32(cycles[n / 2]);
+    serial_print(" p99 "); serial_print_u32(cycles[(n * 99) / 100]);
+    serial_print(" cycles\r\n");
+}
+
+static void trace_metrics(const struct bench_trace *t, u32 i, cpu_metrics_t *metrics) {
+    const struct bench_sample *s = &t->samples[i % t->count];
+    memset(metrics, 0, sizeof(*metrics));
+    irq_total += s->irqs;
+    metrics->timestamp = (u64)i * SAMPLE_PERIOD_NS;
+    metrics->cpu_util = s->cpu_util;
+    metrics->freq = 1000000 + s->cpu_util * 15000;
+    metrics->irq_count = irq_total;
+    metrics->process_switches = s->irqs / 4;
+    metrics->idle_time = (u64)(100 - s->cpu_util) * (SAMPLE_PERIOD_NS / 100);
+    metrics->iowait = s->iowait;
+    metrics->runnable_tasks = s->runnable_tasks;
+}
+
+// Feed one full pass of the trace and learn its patterns
+static u32 warm_model(const struct bench_trace *t) {
+    cpu_metrics_t metrics;
+    init_prediction_model(&model);
+    irq_total = 0;
+    for (u32 i = 0; i < t->count; i++) {
+        trace_metrics(t, i, &metrics);
+        add_metrics_to_history(&model, &metrics);
+    }
+    update_patterns(&model);
+    return t->count;
+}
+
+static void bench_predict(const struct bench_trace *t) {
+    cpu_metrics_t metrics;
+    u32 next = warm_model(t);
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        trace_metrics(t, next++, &metrics);
+        add_metrics_to_history(&model, &metrics);
+        u64 start = tsc_read();
+        sink = predict_cpu_utilization(&model);
+        cycles[i] = tsc_delta(start);
+    }
+    report("predict_cpu_utilization", t, BENCH_ITERATIONS);
+}
+
+static void bench_update_patterns(const struct bench_trace *t) {
+    cpu_metrics_t metrics;
+    u32 next = warm_model(t);
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        trace_metrics(t, next++, &metrics);
+        add_metrics_to_history(&model, &metrics);
+        u64 start = tsc_read();
+        update_patterns(&model);
+        cycles[i] = tsc_delta(start);
+    }
+    report("update_patterns", t, BENCH_ITERATIONS);
+}
+
+static void bench_signature_match(const struct bench_trace *t) {
+    cpu_metrics_t metrics;
+    u8 signature[16];
+    u32 next = warm_model(t);
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        trace_metrics(t, next++, &metrics);
+        add_metrics_to_history(&model, &metrics);
+        generate_pattern_signature(&model.history[(model.history_index - 1 + HISTORY_SIZE) % HISTORY_SIZE],
+                                   &model.history[(model.history_index - 2 + HISTORY_SIZE) % HISTORY_SIZE],
+                                   &model.history[(model.history_index - 3 + HISTORY_SIZE) % HISTORY_SIZE],
+                                   signature);
+        const u8 *other = model.pattern_count ?
+            model.patterns[i % model.pattern_count].metrics_signature : signature;
+        u64 start = tsc_read();
+        sink = pattern_signature_match(other, signature);
+        cycles[i] = tsc_delta(start);
+    }
+    report("pattern_signature_match", t, BENCH_ITERATIONS);
+}
+
+void bench_main(void) {
+    serial_init();
+    serial_print("Predictor bare-metal benchmark\r\n");
+
+    unsigned int eax, ebx, ecx, edx;
+    char vendor[13];
+    cpuid(0, &eax, &ebx, &ecx, &edx);
+    *(unsigned int*)&vendor[0] = ebx;
+    *(unsigned int*)&vendor[4] = edx;
+    *(unsigned int*)&vendor[8] = ecx;
+    vendor[12] = 0;
+    serial_print("Vendor: "); serial_print(vendor); serial_print("\r\n");
+
+    calibrate_tsc();
+    serial_print("rdtsc overhead: "); serial_print_u32(tsc_overhead);
+    serial_print(" cycles, iterations: "); serial_print_u32(BENCH_ITERATIONS);
+    serial_print("\r\n");
+
+    for (u32 t = 0; t < ARRAY_SIZE(traces); t++) {
+        bench_predict(&traces[t]);
+        bench_update_patterns(&traces[t]);
+        bench_signature_match(&traces[t]);
+    }
+
+    serial_print("Benchmark done\r\n");
+    outb(DEBUG_EXIT_PORT, 0);
+    while (1)
+        __asm__ __volatile__("hlt");
+}
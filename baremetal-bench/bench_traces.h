@@ -0,0 +1,122 @@
+#ifndef BENCH_TRACES_H
+#define BENCH_TRACES_H
+
+#include <linux/types.h>
+
+/* One compact trace sample, expanded into a cpu_metrics_t at run time */
+struct bench_sample {
+    u8 cpu_util;                   // CPU utilization percentage (0-100)
+    u8 iowait;                     // I/O wait percentage
+    u16 irqs;                      // Interrupts during the sample
+    u8 runnable_tasks;             // Number of tasks in runnable state
+};
+
+/* Periodic batch job: 5 busy samples out of every 16 */
+static const struct bench_sample trace_periodic[] = {
+    { 88,  2,  725, 3}, { 85,  0,  694, 3}, { 82,  1,  706, 3}, { 86,  1,  719, 3},
+    { 87,  0,  717, 3}, {  9,  1,  238, 1}, {  7,  2,  249, 1}, { 12,  2,  255, 1},
+    { 13,  1,  258, 1}, { 13,  1,  266, 1}, { 11,  2,  260, 1}, { 14,  0,  270, 1},
+    { 12,  1,  254, 1}, { 14,  0,  274, 1}, { 13,  2,  267, 1}, { 10,  2,  243, 1},
+    { 83,  2,  678, 3}, { 88,  0,  730, 3}, { 87,  0,  721, 3}, { 88,  1,  730, 3},
+    { 81,  1,  676, 3}, { 10,  0,  270, 1}, { 11,  2,  249, 1}, { 14,  0,  274, 1},
+    {  9,  2,  265, 1}, { 14,  0,  285, 1}, { 11,  0,  271, 1}, { 11,  2,  253, 1},
+    { 10,  1,  275, 1}, {  7,  1,  251, 1}, { 13,  1,  290, 1}, {  7,  2,  223, 1},
+    { 85,  0,  720, 3}, { 89,  2,  721, 3}, { 81,  2,  669, 3}, { 86,  0,  714, 3},
+    { 82,  0,  707, 3}, { 12,  1,  281, 1}, {  6,  0,  238, 1}, {  6,  2,  228, 1},
+    {  9,  1,  246, 1}, { 11,  1,  250, 1}, { 11,  0,  257, 1}, {  7,  0,  240, 1},
+    {  9,  0,  263, 1}, { 13,  0,  272, 1}, { 11,  1,  247, 1}, { 13,  0,  277, 1},
+    { 89,  1,  727, 3}, { 87,  1,  715, 3}, { 89,  0,  735, 3}, { 81,  0,  673, 3},
+    { 88,  2,  747, 3}, {  7,  0,  249, 1}, { 11,  1,  248, 1}, {  8,  0,  253, 1},
+    {  7,  1,  235, 1}, {  8,  2,  229, 1}, {  8,  1,  231, 1}, { 14,  1,  302, 1},
+    {  6,  0,  233, 1}, { 14,  0,  270, 1}, { 14,  2,  298, 1}, { 13,  1,  279, 1},
+    { 89,  0,  739, 3}, { 84,  0,  684, 3}, { 86,  0,  729, 3}, { 84,  2,  704, 3},
+    { 87,  1,  723, 3}, {  7,  0,  260, 1}, {  7,  2,  225, 1}, {  8,  0,  266, 1},
+    { 13,  2,  263, 1}, { 13,  0,  266, 1}, { 10,  2,  276, 1}, { 13,  2,  279, 1},
+    { 14,  2,  288, 1}, { 11,  2,  250, 1}, { 13,  1,  281, 1}, { 13,  1,  289, 1},
+    { 84,  2,  698, 3}, { 89,  2,  753, 3}, { 89,  0,  728, 3}, { 86,  0,  715, 3},
+    { 85,  2,  700, 3}, { 12,  1,  269, 1}, { 12,  1,  253, 1}, {  8,  0,  261, 1},
+    { 13,  2,  260, 1}, {  6,  1,  231, 1}, { 10,  0,  247, 1}, {  8,  0,  247, 1},
+    { 14,  2,  300, 1}, { 12,  2,  268, 1}, { 10,  2,  242, 1}, {  8,  2,  231, 1},
+    { 88,  2,  715, 3}, { 82,  0,  706, 3}, { 86,  2,  736, 3}, { 83,  0,  679, 3},
+    { 84,  0,  718, 3}, { 10,  1,  261, 1}, {  6,  1,  256, 1}, {  7,  2,  223, 1},
+    { 11,  1,  252, 1}, {  7,  0,  261, 1}, {  8,  0,  229, 1}, { 14,  1,  295, 1},
+    {  6,  1,  253, 1}, {  7,  1,  231, 1}, { 11,  1,  267, 1}, { 10,  2,  252, 1},
+    { 86,  1,  708, 3}, { 87,  2,  731, 3}, { 89,  0,  718, 3}, { 87,  2,  729, 3},
+    { 87,  2,  739, 3}, { 12,  1,  279, 1}, { 12,  0,  256, 1}, {  7,  0,  249, 1},
+    {  9,  2,  243, 1}, { 10,  1,  272, 1}, { 12,  1,  263, 1}, { 10,  1,  245, 1},
+    {  7,  0,  253, 1}, {  8,  1,  229, 1}, { 14,  2,  264, 1}, {  6,  2,  227, 1},
+};
+
+/* Bursty request traffic with exponential decay between bursts */
+static const struct bench_sample trace_bursty[] = {
+    { 14,  3,  492, 1}, {  9,  3,  455, 1}, {  6,  3,  478, 1}, {  5,  3,  441, 1},
+    {  5,  1,  400, 1}, {  5,  0,  487, 1}, {  5,  3,  402, 1}, {  5,  3,  407, 1},
+    {  5,  3,  470, 1}, { 95,  2, 1324, 4}, { 66,  1, 1026, 3}, { 46,  3,  834, 2},
+    { 91,  3, 1322, 4}, { 63,  3, 1000, 3}, { 44,  3,  882, 2}, { 30,  1,  689, 2},
+    { 21,  3,  566, 1}, { 14,  3,  565, 1}, {  9,  1,  452, 1}, {  6,  1,  498, 1},
+    { 67,  0, 1066, 3}, { 46,  3,  861, 2}, { 32,  1,  756, 2}, { 22,  3,  651, 1},
+    { 15,  3,  590, 1}, { 10,  0,  515, 1}, {  7,  3,  514, 1}, {  5,  0,  462, 1},
+    { 76,  1, 1131, 4}, { 53,  3,  949, 3}, { 37,  3,  806, 2}, { 25,  3,  654, 2},
+    { 17,  0,  578, 1}, { 11,  3,  462, 1}, {  7,  3,  447, 1}, {  5,  3,  468, 1},
+    {  5,  0,  465, 1}, {  5,  2,  476, 1}, {  5,  2,  431, 1}, {  5,  0,  445, 1},
+    {  5,  1,  448, 1}, {  5,  3,  406, 1}, {  5,  0,  495, 1}, {  5,  0,  407, 1},
+    {  5,  1,  415, 1}, {  5,  0,  498, 1}, { 87,  2, 1269, 4}, { 60,  3, 1035, 3},
+    { 42,  0,  868, 2}, { 29,  3,  655, 2}, { 20,  3,  551, 1}, { 14,  1,  575, 1},
+    {  9,  0,  511, 1}, {  6,  0,  452, 1}, { 86,  3, 1268, 4}, { 60,  1,  967, 3},
+    { 95,  1, 1300, 4}, { 66,  1, 1108, 3}, { 46,  1,  834, 2}, { 32,  0,  678, 2},
+    { 22,  0,  582, 1}, { 15,  1,  564, 1}, { 10,  0,  493, 1}, { 66,  0, 1079, 3},
+    { 46,  1,  814, 2}, { 32,  0,  769, 2}, {100,  2, 1398, 5}, { 70,  3, 1149, 3},
+    { 49,  3,  874, 2}, { 34,  3,  720, 2}, { 23,  0,  581, 1}, { 16,  1,  586, 1},
+    { 11,  1,  483, 1}, {  7,  3,  509, 1}, {  5,  1,  495, 1}, {  5,  2,  497, 1},
+    {  5,  0,  500, 1}, {  5,  2,  408, 1}, {  5,  3,  426, 1}, {  5,  3,  430, 1},
+    {  5,  2,  431, 1}, {  5,  1,  475, 1}, {  5,  1,  465, 1}, {  5,  1,  492, 1},
+    {  5,  3,  420, 1}, {  5,  0,  455, 1}, {  5,  1,  455, 1}, {  5,  3,  467, 1},
+    {  5,  1,  401, 1}, { 95,  2, 1309, 4}, { 66,  3, 1102, 3}, { 46,  1,  849, 2},
+    { 32,  2,  702, 2}, { 80,  1, 1229, 4}, { 56,  3,  922, 3}, { 39,  1,  788, 2},
+    { 27,  3,  620, 2}, { 18,  1,  591, 1}, { 12,  3,  472, 1}, { 62,  1, 1025, 3},
+    { 43,  2,  809, 2}, { 30,  1,  729, 2}, { 21,  0,  642, 1}, { 14,  0,  580, 1},
+    { 90,  0, 1311, 4}, { 62,  2, 1065, 3}, { 43,  1,  799, 2}, { 30,  0,  716, 2},
+    { 21,  3,  612, 1}, { 14,  3,  516, 1}, {  9,  1,  515, 1}, {  6,  1,  490, 1},
+    {  5,  1,  484, 1}, { 83,  1, 1218, 4}, { 58,  0, 1022, 3}, { 40,  0,  844, 2},
+    { 28,  3,  670, 2}, { 19,  3,  613, 1}, { 13,  3,  578, 1}, {  9,  1,  518, 1},
+    {  6,  3,  483, 1}, {  5,  1,  427, 1}, {  5,  2,  497, 1}, {  5,  3,  420, 1},
+    {  5,  2,  470, 1}, {  5,  2,  487, 1}, {  5,  3,  414, 1}, {  5,  0,  418, 1},
+};
+
+/* I/O bound service: iowait phase followed by completion processing */
+static const struct bench_sample trace_io[] = {
+    { 17, 59,  337, 1}, { 16, 61,  300, 1}, { 11, 65,  369, 1}, { 14, 60,  315, 1},
+    { 68,  0, 1500, 3}, { 70,  2, 1500, 3}, { 69,  0,  374, 3}, { 32, 22,  360, 2},
+    { 26, 15,  320, 2}, { 31, 17,  371, 2}, { 33, 22,  327, 2}, { 34, 16,  370, 2},
+    { 13, 63,  304, 1}, { 10, 55,  328, 1}, { 16, 58,  367, 1}, { 14, 55,  329, 1},
+    { 74,  1, 1500, 3}, { 71,  0, 1500, 3}, { 66,  9,  335, 3}, { 28, 19,  356, 2},
+    { 33, 18,  363, 2}, { 27, 18,  321, 2}, { 32, 16,  344, 2}, { 32, 25,  368, 2},
+    { 20, 55,  342, 1}, { 18, 55,  375, 1}, { 13, 61,  327, 1}, { 15, 64,  333, 1},
+    { 65,  2, 1500, 3}, { 70,  2, 1500, 3}, { 68,  4,  311, 3}, { 28, 25,  315, 2},
+    { 26, 16,  327, 2}, { 27, 20,  301, 2}, { 27, 18,  337, 2}, { 29, 22,  373, 2},
+    { 12, 65,  316, 1}, { 11, 56,  350, 1}, { 15, 64,  359, 1}, { 18, 55,  329, 1},
+    { 75, 10, 1500, 3}, { 66,  5, 1500, 3}, { 70,  8,  368, 3}, { 34, 17,  318, 2},
+    { 25, 24,  301, 2}, { 32, 18,  308, 2}, { 35, 16,  369, 2}, { 26, 25,  304, 2},
+    { 11, 63,  377, 1}, { 20, 56,  335, 1}, { 14, 61,  322, 1}, { 12, 61,  348, 1},
+    { 74,  2, 1500, 3}, { 70,  9, 1500, 3}, { 74,  8,  307, 3}, { 32, 21,  320, 2},
+    { 34, 19,  346, 2}, { 32, 17,  359, 2}, { 33, 22,  327, 2}, { 28, 22,  361, 2},
+    { 13, 61,  320, 1}, { 20, 64,  341, 1}, { 16, 60,  334, 1}, { 13, 61,  339, 1},
+    { 72,  1, 1500, 3}, { 72,  4, 1500, 3}, { 66,  7,  302, 3}, { 26, 20,  344, 2},
+    { 30, 24,  329, 2}, { 30, 18,  344, 2}, { 25, 16,  370, 2}, { 32, 15,  337, 2},
+    { 12, 65,  300, 1}, { 11, 63,  301, 1}, { 12, 58,  331, 1}, { 19, 65,  353, 1},
+    { 69,  5, 1500, 3}, { 65,  3, 1500, 3}, { 72,  2,  371, 3}, { 30, 19,  300, 2},
+    { 30, 21,  321, 2}, { 34, 16,  307, 2}, { 35, 21,  367, 2}, { 31, 25,  369, 2},
+    { 17, 61,  358, 1}, { 13, 57,  356, 1}, { 12, 62,  328, 1}, { 11, 63,  322, 1},
+    { 71,  7, 1500, 3}, { 67,  4, 1500, 3}, { 74, 10,  311, 3}, { 34, 22,  318, 2},
+    { 32, 19,  312, 2}, { 35, 22,  347, 2}, { 30, 17,  309, 2}, { 32, 15,  357, 2},
+    { 16, 57,  320, 1}, { 15, 57,  349, 1}, { 20, 63,  323, 1}, { 12, 57,  367, 1},
+    { 68,  1, 1500, 3}, { 70,  0, 1500, 3}, { 72,  8,  337, 3}, { 31, 24,  338, 2},
+    { 33, 16,  327, 2}, { 27, 25,  306, 2}, { 27, 23,  357, 2}, { 33, 21,  327, 2},
+    { 12, 56,  306, 1}, { 12, 60,  344, 1}, { 15, 56,  325, 1}, { 16, 62,  322, 1},
+    { 75, 10, 1500, 3}, { 69,  7, 1500, 3}, { 67,  7,  313, 3}, { 25, 20,  306, 2},
+    { 28, 22,  347, 2}, { 28, 17,  332, 2}, { 35, 17,  311, 2}, { 32, 23,  377, 2},
+    { 15, 61,  378, 1}, { 17, 61,  343, 1}, { 15, 60,  349, 1}, { 13, 61,  334, 1},
+    { 72,  3, 1500, 3}, { 71,  5, 1500, 3}, { 72,  0,  376, 3}, { 29, 17,  353, 2},
+};
+
+#endif // BENCH_TRACES_H
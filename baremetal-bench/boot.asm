@@ -0,0 +1,80 @@
+; boot.asm - Boot sector for the predictor benchmark image
+; Loads the rest of the image with INT 13h extensions, switches to 32-bit
+; protected mode and calls bench_main. Assemble with nasm -f elf32.
+BITS 16
+SECTION .boot
+
+global _start
+extern bench_main
+extern __bss_start
+extern __bss_end
+
+_start:
+    cli
+    xor ax, ax
+    mov ds, ax
+    mov es, ax
+    mov ss, ax
+    mov sp, 0x7C00
+
+    ; Read BENCH_SECTORS sectors after the boot sector to 0x7E00 (DL = boot drive)
+    mov si, dap
+    mov ah, 0x42
+    int 0x13
+    jc disk_error
+
+    ; Switch to 32-bit protected mode
+    lgdt [gdt_desc]
+    mov eax, cr0
+    or eax, 1
+    mov cr0, eax
+    jmp 0x08:protected_mode
+
+disk_error:
+    hlt
+    jmp disk_error
+
+; Disk address packet
+align 4
+dap:
+    db 0x10, 0
+    dw BENCH_SECTORS
+    dw 0x0000, 0x07E0              ; offset, segment
+    dq 1                           ; start LBA
+
+; GDT
+align 8
+gdt_start:
+    dq 0x0000000000000000 ; null
+    dq 0x00CF9A000000FFFF ; code
+    dq 0x00CF92000000FFFF ; data
+gdt_end:
+gdt_desc:
+    dw gdt_end - gdt_start - 1
+    dd gdt_start
+
+; 32-bit code
+[BITS 32]
+protected_mode:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+    mov esp, 0x90000
+
+    ; Clear .bss, it lies past the loaded image
+    mov edi, __bss_start
+    mov ecx, __bss_end
+    sub ecx, edi
+    xor eax, eax
+    cld
+    rep stosb
+
+    call bench_main
+
+    jmp $
+
+times 510-($-$$) db 0
+    dw 0xAA55
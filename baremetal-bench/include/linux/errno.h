@@ -0,0 +1,8 @@
+/* Freestanding stand-in for <linux/errno.h> */
+#ifndef _BENCH_LINUX_ERRNO_H
+#define _BENCH_LINUX_ERRNO_H
+
+#define ENOMEM 12
+#define EINVAL 22
+
+#endif
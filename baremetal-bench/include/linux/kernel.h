@@ -0,0 +1,16 @@
+/* Freestanding stand-in for <linux/kernel.h> used by the bare-metal bench */
+#ifndef _BENCH_LINUX_KERNEL_H
+#define _BENCH_LINUX_KERNEL_H
+
+#include <linux/types.h>
+
+#define abs(x) ({ typeof(x) __x = (x); __x < 0 ? -__x : __x; })
+#define min(x, y) ({ typeof(x) __x = (x); typeof(y) __y = (y); __x < __y ? __x : __y; })
+#define max(x, y) ({ typeof(x) __x = (x); typeof(y) __y = (y); __x > __y ? __x : __y; })
+#define min_t(type, x, y) min((type)(x), (type)(y))
+#define max_t(type, x, y) max((type)(x), (type)(y))
+#define clamp(val, lo, hi) min(max(val, lo), hi)
+#define clamp_t(type, val, lo, hi) clamp((type)(val), (type)(lo), (type)(hi))
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+#endif
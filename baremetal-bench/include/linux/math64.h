@@ -0,0 +1,33 @@
+/* Freestanding stand-in for <linux/math64.h>; no libgcc on a 32-bit target */
+#ifndef _BENCH_LINUX_MATH64_H
+#define _BENCH_LINUX_MATH64_H
+
+#include <linux/types.h>
+
+static inline u64 div64_u64(u64 dividend, u64 divisor)
+{
+    u64 quotient = 0, bit = 1;
+
+    if (!divisor)
+        return 0;
+    while (divisor < dividend && !(divisor & (1ULL << 63))) {
+        divisor <<= 1;
+        bit <<= 1;
+    }
+    while (bit) {
+        if (dividend >= divisor) {
+            dividend -= divisor;
+            quotient |= bit;
+        }
+        divisor >>= 1;
+        bit >>= 1;
+    }
+    return quotient;
+}
+
+static inline u64 div_u64(u64 dividend, u32 divisor)
+{
+    return div64_u64(dividend, divisor);
+}
+
+#endif
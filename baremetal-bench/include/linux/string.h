@@ -0,0 +1,10 @@
+/* Freestanding stand-in for <linux/string.h>, implemented in bench_main.c */
+#ifndef _BENCH_LINUX_STRING_H
+#define _BENCH_LINUX_STRING_H
+
+#include <linux/types.h>
+
+void *memset(void *s, int c, size_t n);
+void *memcpy(void *dest, const void *src, size_t n);
+
+#endif
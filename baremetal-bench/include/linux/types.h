@@ -0,0 +1,18 @@
+/* Freestanding stand-in for <linux/types.h> used by the bare-metal bench */
+#ifndef _BENCH_LINUX_TYPES_H
+#define _BENCH_LINUX_TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+#endif
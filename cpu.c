@@ -1,8 +1,19 @@
-/* cpu.c - Minimal CPU detection implementation */
+/* cpu.c - CPU detection implementation */
+#define _GNU_SOURCE
+#include <sched.h>
 #include "cpu.h"
 
 struct cpuinfo_x86 boot_cpu_data;
 
+static int cpu_detected;
+static unsigned int max_leaf;
+static unsigned int max_ext_leaf;
+
+/* APIC ID field widths, used to split an APIC ID into package/core/thread */
+static unsigned int smt_shift;
+static unsigned int pkg_shift;
+static unsigned int llc_shift;
+
 /* Basic CPUID wrapper */
 unsigned int cpuid(unsigned int op, unsigned int *eax, unsigned int *ebx, 
                    unsigned int *ecx, unsigned int *edx) {
@@ -17,12 +28,42 @@ unsigned int cpuid(unsigned int op, unsigned int *eax, unsigned int *ebx,
     return *eax;
 }
 
+/* CPUID wrapper for leaves that take a subleaf in ECX */
+unsigned int cpuid_count(unsigned int op, unsigned int count, unsigned int *eax,
+                         unsigned int *ebx, unsigned int *ecx, unsigned int *edx) {
+    __asm__ __volatile__(
+        "cpuid"
+        : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+        : "0" (op), "2" (count)
+    );
+
+    return *eax;
+}
+
+/* Read XCR0 to see which register state the OS saves on context switch */
+static uint64_t read_xcr0(void) {
+    unsigned int lo, hi;
+
+    __asm__ __volatile__("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* Smallest shift such that (1 << shift) >= count */
+static unsigned int count_order(unsigned int count) {
+    unsigned int shift = 0;
+
+    while ((1u << shift) < count && shift < 31)
+        shift++;
+    return shift;
+}
+
 /* Detect CPU vendor */
 static void get_cpu_vendor(void) {
     unsigned int eax, ebx, ecx, edx;
     char vendor_string[13];
     
     cpuid(0, &eax, &ebx, &ecx, &edx);
+    max_leaf = eax;
     
     /* Get vendor string */
     vendor_string[0] = ebx & 0xff;
@@ -60,10 +101,10 @@ static void get_cpu_signature(void) {
     boot_cpu_data.stepping = eax & 0xf;
     
     /* Handle extended family/model */
-    if (boot_cpu_data.family == 0xf) {
+    if (boot_cpu_data.family == 0xf)
         boot_cpu_data.family += (eax >> 20) & 0xff;
+    if (boot_cpu_data.family == 0x6 || boot_cpu_data.family >= 0xf)
         boot_cpu_data.model += ((eax >> 16) & 0xf) << 4;
-    }
 }
 
 /* Get basic features */
@@ -79,18 +120,338 @@ static void get_cpu_features(void) {
     if (edx & (1 << 26)) boot_cpu_data.features |= CPU_FEATURE_SSE2;
 }
 
+/* Get SIMD, power management and hybrid features */
+static void get_cpu_ext_features(void) {
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int leaf7_ebx = 0, leaf7_edx = 0;
+    uint64_t xcr0 = 0;
+    int xf = 0;
+
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (ecx & (1 << 27))            /* OSXSAVE */
+        xcr0 = read_xcr0();
+
+    if (max_leaf >= 7) {
+        cpuid_count(7, 0, &eax, &ebx, &ecx, &edx);
+        leaf7_ebx = ebx;
+        leaf7_edx = edx;
+    }
+
+    /* AVX needs XMM and YMM state enabled by the OS */
+    if ((xcr0 & 0x6) == 0x6) {
+        cpuid(1, &eax, &ebx, &ecx, &edx);
+        if (ecx & (1 << 28)) xf |= CPU_XFEATURE_AVX;
+        if (ecx & (1 << 12)) xf |= CPU_XFEATURE_FMA;
+        if (leaf7_ebx & (1 << 5)) xf |= CPU_XFEATURE_AVX2;
+    }
+
+    /* AVX-512 additionally needs opmask and ZMM state */
+    if ((xcr0 & 0xe6) == 0xe6) {
+        if (leaf7_ebx & (1 << 16)) xf |= CPU_XFEATURE_AVX512F;
+        if (leaf7_ebx & (1 << 17)) xf |= CPU_XFEATURE_AVX512DQ;
+        if (leaf7_ebx & (1 << 30)) xf |= CPU_XFEATURE_AVX512BW;
+        if (leaf7_ebx & (1u << 31)) xf |= CPU_XFEATURE_AVX512VL;
+    }
+
+    if (leaf7_edx & (1 << 15)) xf |= CPU_XFEATURE_HYBRID;
+
+    /* Thermal and power management leaf */
+    if (max_leaf >= 6) {
+        cpuid(6, &eax, &ebx, &ecx, &edx);
+        if (eax & (1 << 1)) xf |= CPU_XFEATURE_TURBO;
+        if (eax & (1 << 7)) xf |= CPU_XFEATURE_HWP;
+        if (ecx & (1 << 0)) xf |= CPU_XFEATURE_APERFMPERF;
+    }
+
+    if (max_ext_leaf >= 0x80000007) {
+        cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+        if (edx & (1 << 8)) xf |= CPU_XFEATURE_INVARIANT_TSC;
+    }
+
+    boot_cpu_data.ext_features = xf;
+
+    if ((xf & CPU_XFEATURE_HYBRID) && max_leaf >= 0x1a) {
+        cpuid_count(0x1a, 0, &eax, &ebx, &ecx, &edx);
+        boot_cpu_data.core_type = (eax >> 24) & 0xff;
+    }
+}
+
+/* Parse the "@ 3.40GHz" suffix of the brand string, 0 if there is none */
+static int brand_string_mhz(void) {
+    unsigned int regs[12];
+    const char *brand = (const char *)regs;
+    const char *unit, *p;
+    int mhz = 0, scale = 1000;
+
+    if (max_ext_leaf < 0x80000004)
+        return 0;
+    for (unsigned int i = 0; i < 3; i++)
+        cpuid(0x80000002 + i, &regs[i * 4], &regs[i * 4 + 1], &regs[i * 4 + 2], &regs[i * 4 + 3]);
+    regs[11] &= 0x00ffffff;   /* Terminate even if the string fills all three leaves */
+
+    unit = strstr(brand, "GHz");
+    if (!unit) {
+        unit = strstr(brand, "MHz");
+        scale = 1;
+    }
+    if (!unit)
+        return 0;
+
+    /* Back up over the number in front of the unit */
+    p = unit;
+    while (p > brand && ((p[-1] >= '0' && p[-1] <= '9') || p[-1] == '.'))
+        p--;
+    for (; p < unit && *p != '.'; p++)
+        mhz = mhz * 10 + (*p - '0');
+    mhz *= scale;
+    if (p < unit && *p == '.') {
+        for (p++; p < unit && scale > 1; p++) {
+            scale /= 10;
+            mhz += (*p - '0') * scale;
+        }
+    }
+    return mhz;
+}
+
+/*
+ * Base/max/bus frequency from leaf 0x16. Without it, the nominal clock comes
+ * from the TSC/crystal ratio of leaf 0x15 or the brand string; mhz stays 0
+ * when none of them is available (most AMD parts and VMs lack both leaves).
+ */
+static void get_cpu_frequency(void) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (max_leaf >= 0x16) {
+        cpuid(0x16, &eax, &ebx, &ecx, &edx);
+        boot_cpu_data.base_mhz = eax & 0xffff;
+        boot_cpu_data.max_mhz = ebx & 0xffff;
+        boot_cpu_data.bus_mhz = ecx & 0xffff;
+    }
+    boot_cpu_data.mhz = boot_cpu_data.base_mhz;
+
+    if (!boot_cpu_data.mhz && max_leaf >= 0x15) {
+        cpuid(0x15, &eax, &ebx, &ecx, &edx);
+        if (eax && ebx && ecx)
+            boot_cpu_data.mhz = (int)((uint64_t)ecx * ebx / eax / 1000000);
+    }
+    if (!boot_cpu_data.mhz)
+        boot_cpu_data.mhz = brand_string_mhz();
+}
+
+/* Walk the deterministic cache parameter leaf (4 on Intel, 0x8000001D on AMD) */
+static void get_cpu_caches(void) {
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int leaf = 0;
+    int llc_level = 0;
+
+    if (boot_cpu_data.vendor == CPU_VENDOR_INTEL && max_leaf >= 4) {
+        leaf = 4;
+    } else if (boot_cpu_data.vendor == CPU_VENDOR_AMD && max_ext_leaf >= 0x8000001d) {
+        cpuid(0x80000001, &eax, &ebx, &ecx, &edx);
+        if (ecx & (1 << 22))        /* TOPOEXT */
+            leaf = 0x8000001d;
+    }
+
+    boot_cpu_data.cache_count = 0;
+    for (unsigned int i = 0; leaf && boot_cpu_data.cache_count < CPU_MAX_CACHES; i++) {
+        struct cpu_cache_desc *c = &boot_cpu_data.caches[boot_cpu_data.cache_count];
+        int type;
+
+        cpuid_count(leaf, i, &eax, &ebx, &ecx, &edx);
+        type = eax & 0x1f;
+        if (type == CPU_CACHE_NULL)
+            break;
+
+        c->type = type;
+        c->level = (eax >> 5) & 0x7;
+        c->shared_by = ((eax >> 14) & 0xfff) + 1;
+        c->line_size = (ebx & 0xfff) + 1;
+        c->ways = ((ebx >> 22) & 0x3ff) + 1;
+        c->sets = ecx + 1;
+        c->size_kb = (int)(((uint64_t)c->ways * (((ebx >> 12) & 0x3ff) + 1) *
+                            c->line_size * c->sets) / 1024);
+        boot_cpu_data.cache_count++;
+
+        if (c->level > llc_level) {
+            llc_level = c->level;
+            llc_shift = count_order(c->shared_by);
+        }
+    }
+
+    for (int i = 0; i < boot_cpu_data.cache_count; i++) {
+        struct cpu_cache_desc *c = &boot_cpu_data.caches[i];
+
+        if (c->level == 1 && c->type == CPU_CACHE_INSTRUCTION)
+            boot_cpu_data.l1i_cache_size = c->size_kb;
+        else if (c->level == 1)
+            boot_cpu_data.l1_cache_size = c->size_kb;
+        else if (c->level == 2)
+            boot_cpu_data.l2_cache_size = c->size_kb;
+        else if (c->level == 3)
+            boot_cpu_data.l3_cache_size = c->size_kb;
+    }
+
+    /* Older AMD parts only have the legacy size leaves */
+    if (!boot_cpu_data.cache_count && boot_cpu_data.vendor == CPU_VENDOR_AMD) {
+        if (max_ext_leaf >= 0x80000005) {
+            cpuid(0x80000005, &eax, &ebx, &ecx, &edx);
+            boot_cpu_data.l1_cache_size = (ecx >> 24) & 0xff;
+            boot_cpu_data.l1i_cache_size = (edx >> 24) & 0xff;
+        }
+        if (max_ext_leaf >= 0x80000006) {
+            cpuid(0x80000006, &eax, &ebx, &ecx, &edx);
+            boot_cpu_data.l2_cache_size = (ecx >> 16) & 0xffff;
+            boot_cpu_data.l3_cache_size = ((edx >> 18) & 0x3fff) * 512;
+        }
+    }
+}
+
+/* Get core/thread counts from leaf 0x1F/0xB, falling back to leaf 1 */
+static void get_cpu_topology(void) {
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int leaf = 0;
+    unsigned int logical = 0, smt = 0;
+
+    if (max_leaf >= 0x1f) {
+        cpuid_count(0x1f, 0, &eax, &ebx, &ecx, &edx);
+        if (ebx)
+            leaf = 0x1f;
+    }
+    if (!leaf && max_leaf >= 0xb) {
+        cpuid_count(0xb, 0, &eax, &ebx, &ecx, &edx);
+        if (ebx)
+            leaf = 0xb;
+    }
+
+    for (unsigned int i = 0; leaf; i++) {
+        unsigned int level_type;
+
+        cpuid_count(leaf, i, &eax, &ebx, &ecx, &edx);
+        level_type = (ecx >> 8) & 0xff;
+        if (level_type == 0)
+            break;
+
+        if (level_type == 1) {      /* SMT */
+            smt_shift = eax & 0x1f;
+            smt = ebx & 0xffff;
+        }
+        /* The last valid level spans the whole package */
+        pkg_shift = eax & 0x1f;
+        logical = ebx & 0xffff;
+    }
+
+    if (!leaf) {
+        cpuid(1, &eax, &ebx, &ecx, &edx);
+        logical = (edx & (1 << 28)) ? (ebx >> 16) & 0xff : 1;
+        pkg_shift = count_order(logical);
+        smt = 1;
+
+        if (boot_cpu_data.vendor == CPU_VENDOR_AMD && max_ext_leaf >= 0x8000001e) {
+            cpuid(0x8000001e, &eax, &ebx, &ecx, &edx);
+            smt = ((ebx >> 8) & 0xff) + 1;
+        }
+        smt_shift = count_order(smt);
+    }
+
+    if (logical == 0)
+        logical = 1;
+    if (smt == 0)
+        smt = 1;
+
+    boot_cpu_data.threads = logical;
+    boot_cpu_data.threads_per_core = smt;
+    boot_cpu_data.cores = logical / smt ? logical / smt : 1;
+    if (!llc_shift)
+        llc_shift = pkg_shift;
+}
+
 /* Main CPU detection function */
 void cpu_detect(void) {
+    unsigned int eax, ebx, ecx, edx;
+
+    memset(&boot_cpu_data, 0, sizeof(boot_cpu_data));
+    smt_shift = pkg_shift = llc_shift = 0;
+
     get_cpu_vendor();
+    cpuid(0x80000000, &eax, &ebx, &ecx, &edx);
+    max_ext_leaf = eax >= 0x80000000 ? eax : 0;
+
     get_cpu_signature();
     get_cpu_features();
-    
-    /* Set default values for what we can't detect */
-    boot_cpu_data.mhz = 1000;        /* Default to 1GHz */
-    boot_cpu_data.l1_cache_size = 32;  /* Default 32KB L1 */
-    boot_cpu_data.l2_cache_size = 256; /* Default 256KB L2 */
-    boot_cpu_data.cores = 1;         /* Default single core */
-    boot_cpu_data.threads = 1;       /* Default single thread */
+    get_cpu_ext_features();
+    get_cpu_frequency();
+    get_cpu_caches();
+    get_cpu_topology();
+
+    cpu_detected = 1;
+}
+
+/* Check an extended feature flag */
+int cpu_has(int xfeature) {
+    if (!cpu_detected)
+        cpu_detect();
+    return (boot_cpu_data.ext_features & xfeature) != 0;
+}
+
+/* Look up a cache by level and type; CPU_CACHE_NULL matches any type */
+const struct cpu_cache_desc *cpu_get_cache(int level, int type) {
+    if (!cpu_detected)
+        cpu_detect();
+
+    for (int i = 0; i < boot_cpu_data.cache_count; i++) {
+        const struct cpu_cache_desc *c = &boot_cpu_data.caches[i];
+
+        if (c->level != level)
+            continue;
+        if (type == CPU_CACHE_NULL || c->type == type)
+            return c;
+    }
+    return NULL;
+}
+
+/*
+ * Get package/core/thread placement of a logical CPU. CPUID describes the
+ * CPU it executes on, so the calling thread is briefly pinned to @cpu.
+ * Returns 0 on success, -1 if the CPU cannot be scheduled on.
+ */
+int cpu_get_topology(int cpu, struct cpu_topology *topo) {
+    unsigned int eax, ebx, ecx, edx;
+    cpu_set_t old_mask, mask;
+    unsigned int apic_id;
+
+    if (!cpu_detected)
+        cpu_detect();
+
+    if (sched_getaffinity(0, sizeof(old_mask), &old_mask))
+        return -1;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu, &mask);
+    if (sched_setaffinity(0, sizeof(mask), &mask))
+        return -1;
+
+    if (max_leaf >= 0xb) {
+        cpuid_count(0xb, 0, &eax, &ebx, &ecx, &edx);
+        apic_id = edx;
+    } else {
+        cpuid(1, &eax, &ebx, &ecx, &edx);
+        apic_id = (ebx >> 24) & 0xff;
+    }
+
+    memset(topo, 0, sizeof(*topo));
+    topo->cpu = cpu;
+    topo->apic_id = apic_id;
+    topo->smt_id = apic_id & ((1u << smt_shift) - 1);
+    topo->core_id = (apic_id & ((1u << pkg_shift) - 1)) >> smt_shift;
+    topo->package_id = apic_id >> pkg_shift;
+    topo->llc_id = apic_id >> llc_shift;
+
+    if ((boot_cpu_data.ext_features & CPU_XFEATURE_HYBRID) && max_leaf >= 0x1a) {
+        cpuid_count(0x1a, 0, &eax, &ebx, &ecx, &edx);
+        topo->core_type = (eax >> 24) & 0xff;
+    }
+
+    sched_setaffinity(0, sizeof(old_mask), &old_mask);
+    return 0;
 }
 
 /* Initialize CPU */
@@ -124,15 +485,43 @@ void print_cpu_info(void) {
     printf("CPU: %s Family %d Model %d Stepping %d\n",
            vendor_str, boot_cpu_data.family, 
            boot_cpu_data.model, boot_cpu_data.stepping);
-    printf("Clock: %d MHz\n", boot_cpu_data.mhz);
-    printf("Cache: L1 %dKB, L2 %dKB\n", 
-           boot_cpu_data.l1_cache_size, boot_cpu_data.l2_cache_size);
-    printf("Cores: %d, Threads: %d\n", 
-           boot_cpu_data.cores, boot_cpu_data.threads);
+    if (boot_cpu_data.mhz)
+        printf("Clock: %d MHz", boot_cpu_data.mhz);
+    else
+        printf("Clock: unknown");
+    printf(" (base %d, max %d, bus %d)\n",
+           boot_cpu_data.base_mhz, boot_cpu_data.max_mhz, boot_cpu_data.bus_mhz);
+    printf("Cache: L1d %dKB, L1i %dKB, L2 %dKB, L3 %dKB\n",
+           boot_cpu_data.l1_cache_size, boot_cpu_data.l1i_cache_size,
+           boot_cpu_data.l2_cache_size, boot_cpu_data.l3_cache_size);
+    for (int i = 0; i < boot_cpu_data.cache_count; i++) {
+        const struct cpu_cache_desc *c = &boot_cpu_data.caches[i];
+
+        printf("  L%d %s: %dKB, %d-way, %dB lines, shared by %d\n", c->level,
+               c->type == CPU_CACHE_DATA ? "data" :
+               c->type == CPU_CACHE_INSTRUCTION ? "inst" : "unified",
+               c->size_kb, c->ways, c->line_size, c->shared_by);
+    }
+    printf("Cores: %d, Threads: %d (%d per core)\n",
+           boot_cpu_data.cores, boot_cpu_data.threads,
+           boot_cpu_data.threads_per_core);
+    printf("Features:%s%s%s%s%s%s%s%s%s\n",
+           cpu_has(CPU_XFEATURE_AVX) ? " avx" : "",
+           cpu_has(CPU_XFEATURE_AVX2) ? " avx2" : "",
+           cpu_has(CPU_XFEATURE_FMA) ? " fma" : "",
+           cpu_has(CPU_XFEATURE_AVX512F) ? " avx512f" : "",
+           cpu_has(CPU_XFEATURE_APERFMPERF) ? " aperfmperf" : "",
+           cpu_has(CPU_XFEATURE_INVARIANT_TSC) ? " invariant_tsc" : "",
+           cpu_has(CPU_XFEATURE_TURBO) ? " turbo" : "",
+           cpu_has(CPU_XFEATURE_HWP) ? " hwp" : "",
+           cpu_has(CPU_XFEATURE_HYBRID) ? " hybrid" : "");
 }
 
+/* Build with -DCPU_NO_MAIN to link the detection API into another program */
+#ifndef CPU_NO_MAIN
 int main(void) {
     cpu_detect();
     print_cpu_info();
     return 0;
 }
+#endif
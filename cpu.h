@@ -1,4 +1,3 @@
-
 #ifndef CPU_H
 #define CPU_H
 
@@ -17,6 +16,44 @@
 #define CPU_FEATURE_SSE    (1 << 25)
 #define CPU_FEATURE_SSE2   (1 << 26)
 
+// Extended feature flags (ext_features). SIMD bits are only set when the
+// OS has also enabled the matching register state in XCR0.
+#define CPU_XFEATURE_AVX          (1 << 0)
+#define CPU_XFEATURE_AVX2         (1 << 1)
+#define CPU_XFEATURE_FMA          (1 << 2)
+#define CPU_XFEATURE_AVX512F      (1 << 3)
+#define CPU_XFEATURE_AVX512DQ     (1 << 4)
+#define CPU_XFEATURE_AVX512BW     (1 << 5)
+#define CPU_XFEATURE_AVX512VL     (1 << 6)
+#define CPU_XFEATURE_APERFMPERF   (1 << 7)   // Frequency-invariant utilization possible
+#define CPU_XFEATURE_INVARIANT_TSC (1 << 8)
+#define CPU_XFEATURE_TURBO        (1 << 9)
+#define CPU_XFEATURE_HWP          (1 << 10)
+#define CPU_XFEATURE_HYBRID       (1 << 11)
+
+// Cache types as reported by CPUID leaf 4 / 0x8000001D
+#define CPU_CACHE_NULL        0
+#define CPU_CACHE_DATA        1
+#define CPU_CACHE_INSTRUCTION 2
+#define CPU_CACHE_UNIFIED     3
+
+#define CPU_MAX_CACHES 8
+
+// Hybrid core types (CPUID leaf 0x1A)
+#define CPU_CORE_TYPE_NONE    0
+#define CPU_CORE_TYPE_ATOM    0x20
+#define CPU_CORE_TYPE_CORE    0x40
+
+struct cpu_cache_desc {
+    int level;                      // 1, 2, 3...
+    int type;                       // CPU_CACHE_*
+    int size_kb;
+    int ways;
+    int line_size;
+    int sets;
+    int shared_by;                  // Logical CPUs sharing this cache
+};
+
 struct cpuinfo_x86 {
     int vendor;
     int family;
@@ -28,12 +65,43 @@ struct cpuinfo_x86 {
     int l2_cache_size;
     int cores;
     int threads;
+
+    int ext_features;               // CPU_XFEATURE_*
+    int base_mhz;                   // Leaf 0x16, 0 if unknown
+    int max_mhz;
+    int bus_mhz;
+    int l1i_cache_size;
+    int l3_cache_size;
+    int threads_per_core;
+    int core_type;                  // CPU_CORE_TYPE_* of the detecting CPU
+    int cache_count;
+    struct cpu_cache_desc caches[CPU_MAX_CACHES];
+};
+
+// Per logical CPU placement, for grouping CPUs into clusters
+struct cpu_topology {
+    int cpu;                        // OS logical CPU number
+    unsigned int apic_id;           // x2APIC ID (or initial APIC ID)
+    int package_id;
+    int core_id;                    // Core within package
+    int smt_id;                     // Thread within core
+    int core_type;                  // CPU_CORE_TYPE_*
+    int llc_id;                     // Last level cache domain, unique system-wide
 };
 
 extern struct cpuinfo_x86 boot_cpu_data;
 
+unsigned int cpuid(unsigned int op, unsigned int *eax, unsigned int *ebx,
+                   unsigned int *ecx, unsigned int *edx);
+unsigned int cpuid_count(unsigned int op, unsigned int count, unsigned int *eax,
+                         unsigned int *ebx, unsigned int *ecx, unsigned int *edx);
+
 void cpu_detect(void);
 void cpu_init(void);
 void print_cpu_info(void);
 
+int cpu_has(int xfeature);
+const struct cpu_cache_desc *cpu_get_cache(int level, int type);
+int cpu_get_topology(int cpu, struct cpu_topology *topo);
+
 #endif // CPU_H
@@ -0,0 +1,325 @@
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
+#include "cross_policy.h"
+
+/*
+ * Machine-wide lead/lag model between policies. Load on some policies
+ * (IRQ-handling CPUs, for example) reliably shows up a few samples before
+ * load on others. Each policy only publishes its latest utilization; a
+ * single observer work snapshots all policies once per sample period into a
+ * time-aligned ring of utilization deltas. Every CROSS_BATCH_SAMPLES ticks
+ * it correlates each policy's deltas with every other policy's deltas
+ * 1..CROSS_MAX_LAG ticks earlier and keeps the strongest leaders. A policy's
+ * prediction then adds the change its leaders announce for the next sample.
+ * The correlation pass runs on a copy of the ring, outside the lock the
+ * policies' sampling works take.
+ */
+
+#define CROSS_WINDOW (CROSS_BATCH_SAMPLES + CROSS_MAX_LAG)
+
+struct cross_leader {
+    u8 slot;
+    u8 lag;                                  // Leader runs this many ticks ahead
+    s16 beta;                                // Follower delta per leader delta, in 1/100
+    u8 correlation;                          // Squared correlation (%)
+};
+
+struct cross_policy_model {
+    // Under cross_lock
+    bool used[CROSS_MAX_POLICIES];
+    bool stale[CROSS_MAX_POLICIES];          // Registered since the last batch snapshot
+    unsigned int policy_cpu[CROSS_MAX_POLICIES];
+    int latest_util[CROSS_MAX_POLICIES];     // Published by each policy's sampling work, -1 before the first
+    int prev_util[CROSS_MAX_POLICIES];       // Observer's previous snapshot, -1 before the first
+    s8 delta[CROSS_WINDOW][CROSS_MAX_POLICIES];
+    u32 tick;
+    struct cross_leader leaders[CROSS_MAX_POLICIES][CROSS_MAX_LEADERS];
+    u8 leader_count[CROSS_MAX_POLICIES];
+
+    // Owned by the observer work and used outside cross_lock
+    s8 batch[CROSS_WINDOW][CROSS_MAX_POLICIES];    // Copy of delta, oldest tick first
+    bool batch_used[CROSS_MAX_POLICIES];
+    bool batch_reset[CROSS_MAX_POLICIES];          // Slot changed hands; forget its sums
+    // Decaying sums over batches; cov[i][j][l] pairs i at t - (l + 1) with j at t
+    s32 cov[CROSS_MAX_POLICIES][CROSS_MAX_POLICIES][CROSS_MAX_LAG];
+    s32 var[CROSS_MAX_POLICIES];
+    struct cross_leader next_leaders[CROSS_MAX_POLICIES][CROSS_MAX_LEADERS];
+    u8 next_count[CROSS_MAX_POLICIES];
+};
+
+static bool cross_policy = true;
+module_param(cross_policy, bool, 0644);
+MODULE_PARM_DESC(cross_policy, "Add load predicted from correlated policies to each prediction");
+
+/*
+ * Never taken from IRQ context. Sampling works take it with their own
+ * irqsave lock held, so it is only held for short copies.
+ */
+static struct cross_policy_model *cross;
+static DEFINE_SPINLOCK(cross_lock);
+static struct delayed_work cross_work;
+static unsigned int cross_period_ms;
+static struct dentry *cross_debugfs;
+
+static s8 *delta_at(u32 tick, int slot)
+{
+    return &cross->delta[tick % CROSS_WINDOW][slot];
+}
+
+static void pick_leaders(int j)
+{
+    struct cross_leader *leaders = cross->next_leaders[j];
+    u8 count = 0;
+
+    for (int i = 0; i < CROSS_MAX_POLICIES; i++) {
+        if (i == j || !cross->batch_used[i] || cross->var[i] <= 0 || cross->var[j] <= 0)
+            continue;
+        for (int l = 0; l < CROSS_MAX_LAG; l++) {
+            s64 cov = cross->cov[i][j][l];
+            u32 correlation = (u32)div64_s64(cov * cov * 100, (s64)cross->var[i] * cross->var[j]);
+            struct cross_leader candidate;
+            int pos;
+
+            if (correlation < CROSS_MIN_CORRELATION)
+                continue;
+            candidate.slot = i;
+            candidate.lag = l + 1;
+            candidate.beta = (s16)clamp_t(s64, div64_s64(cov * 100, cross->var[i]), -200, 200);
+            candidate.correlation = min_t(u32, correlation, 100);
+
+            // Keep the strongest CROSS_MAX_LEADERS, sorted by correlation
+            pos = count;
+            while (pos > 0 && leaders[pos - 1].correlation < candidate.correlation) {
+                if (pos < CROSS_MAX_LEADERS)
+                    leaders[pos] = leaders[pos - 1];
+                pos--;
+            }
+            if (pos < CROSS_MAX_LEADERS) {
+                leaders[pos] = candidate;
+                if (count < CROSS_MAX_LEADERS)
+                    count++;
+            }
+        }
+    }
+    cross->next_count[j] = count;
+}
+
+// The batched pass over the snapshot: O(policies^2 * lags * batch) once per batch
+static void update_correlations(void)
+{
+    for (int i = 0; i < CROSS_MAX_POLICIES; i++) {
+        if (!cross->batch_reset[i])
+            continue;
+        cross->var[i] = 0;
+        for (int j = 0; j < CROSS_MAX_POLICIES; j++) {
+            memset(cross->cov[i][j], 0, sizeof(cross->cov[i][j]));
+            memset(cross->cov[j][i], 0, sizeof(cross->cov[j][i]));
+        }
+    }
+
+    for (int i = 0; i < CROSS_MAX_POLICIES; i++) {
+        s32 var = 0;
+
+        if (!cross->batch_used[i])
+            continue;
+        for (int t = CROSS_MAX_LAG; t < CROSS_WINDOW; t++)
+            var += cross->batch[t][i] * cross->batch[t][i];
+        cross->var[i] = (cross->var[i] * 3 + var) / 4;
+
+        for (int j = 0; j < CROSS_MAX_POLICIES; j++) {
+            if (j == i || !cross->batch_used[j])
+                continue;
+            for (int l = 0; l < CROSS_MAX_LAG; l++) {
+                s32 cov = 0;
+
+                for (int t = CROSS_MAX_LAG; t < CROSS_WINDOW; t++)
+                    cov += cross->batch[t - l - 1][i] * cross->batch[t][j];
+                cross->cov[i][j][l] = (cross->cov[i][j][l] * 3 + cov) / 4;
+            }
+        }
+    }
+
+    for (int j = 0; j < CROSS_MAX_POLICIES; j++)
+        if (cross->batch_used[j])
+            pick_leaders(j);
+}
+
+// Install the new leaders, skipping anything registered or removed meanwhile
+static void publish_leaders(void)
+{
+    for (int j = 0; j < CROSS_MAX_POLICIES; j++) {
+        u8 kept = 0;
+
+        if (!cross->used[j] || cross->stale[j] || !cross->batch_used[j])
+            continue;
+        for (int k = 0; k < cross->next_count[j]; k++) {
+            int slot = cross->next_leaders[j][k].slot;
+
+            if (cross->used[slot] && !cross->stale[slot])
+                cross->leaders[j][kept++] = cross->next_leaders[j][k];
+        }
+        cross->leader_count[j] = kept;
+    }
+}
+
+static void cross_policy_work(struct work_struct *work)
+{
+    bool batch;
+
+    spin_lock(&cross_lock);
+    for (int i = 0; i < CROSS_MAX_POLICIES; i++) {
+        int util = READ_ONCE(cross->latest_util[i]);
+
+        // A policy's first sample seeds it rather than reading as a jump from 0
+        if (cross->used[i] && util >= 0 && cross->prev_util[i] >= 0)
+            *delta_at(cross->tick, i) = (s8)(util - cross->prev_util[i]);
+        else
+            *delta_at(cross->tick, i) = 0;
+        if (util >= 0)
+            cross->prev_util[i] = util;
+    }
+    cross->tick++;
+    batch = cross->tick >= CROSS_WINDOW && cross->tick % CROSS_BATCH_SAMPLES == 0;
+    if (batch) {
+        for (int t = 0; t < CROSS_WINDOW; t++)
+            memcpy(cross->batch[t], cross->delta[(cross->tick + t) % CROSS_WINDOW],
+                   sizeof(cross->batch[t]));
+        memcpy(cross->batch_used, cross->used, sizeof(cross->batch_used));
+        memcpy(cross->batch_reset, cross->stale, sizeof(cross->batch_reset));
+        memset(cross->stale, 0, sizeof(cross->stale));
+    }
+    spin_unlock(&cross_lock);
+
+    if (batch) {
+        update_correlations();
+        spin_lock(&cross_lock);
+        publish_leaders();
+        spin_unlock(&cross_lock);
+    }
+
+    mod_delayed_work(system_wq, &cross_work, msecs_to_jiffies(cross_period_ms));
+}
+
+static int cross_policy_show(struct seq_file *m, void *v)
+{
+    spin_lock(&cross_lock);
+    for (int j = 0; j < CROSS_MAX_POLICIES; j++) {
+        if (!cross->used[j])
+            continue;
+        seq_printf(m, "policy%u:", cross->policy_cpu[j]);
+        for (int k = 0; k < cross->leader_count[j]; k++) {
+            struct cross_leader *leader = &cross->leaders[j][k];
+
+            seq_printf(m, " policy%u lag %u beta %d r2 %u%%;", cross->policy_cpu[leader->slot],
+                       leader->lag, leader->beta, leader->correlation);
+        }
+        seq_puts(m, "\n");
+    }
+    spin_unlock(&cross_lock);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(cross_policy);
+
+int cross_policy_init(unsigned int sample_rate_ms, struct dentry *debugfs_dir)
+{
+    cross = kvzalloc(sizeof(*cross), GFP_KERNEL);
+    if (!cross)
+        return -ENOMEM;
+    cross_period_ms = sample_rate_ms;
+    cross_debugfs = debugfs_create_file("cross_policy", 0444, debugfs_dir, NULL,
+                                        &cross_policy_fops);
+    INIT_DEFERRABLE_WORK(&cross_work, cross_policy_work);
+    mod_delayed_work(system_wq, &cross_work, msecs_to_jiffies(cross_period_ms));
+    return 0;
+}
+
+void cross_policy_exit(void)
+{
+    cancel_delayed_work_sync(&cross_work);
+    debugfs_remove(cross_debugfs);
+    kvfree(cross);
+    cross = NULL;
+}
+
+// Returns a slot for the policy, or -1 if the model is full
+int cross_policy_register(unsigned int policy_cpu)
+{
+    int slot = -1;
+
+    if (!cross)
+        return -1;
+
+    spin_lock(&cross_lock);
+    for (int i = 0; i < CROSS_MAX_POLICIES; i++) {
+        if (!cross->used[i]) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot >= 0) {
+        cross->used[slot] = true;
+        cross->stale[slot] = true;
+        cross->policy_cpu[slot] = policy_cpu;
+        cross->latest_util[slot] = -1;
+        cross->prev_util[slot] = -1;
+        cross->leader_count[slot] = 0;
+        // The previous owner's deltas must not feed the next batch
+        for (int t = 0; t < CROSS_WINDOW; t++)
+            cross->delta[t][slot] = 0;
+    }
+    spin_unlock(&cross_lock);
+    return slot;
+}
+
+void cross_policy_unregister(int slot)
+{
+    if (!cross || slot < 0)
+        return;
+
+    spin_lock(&cross_lock);
+    cross->used[slot] = false;
+    cross->leader_count[slot] = 0;
+    // Nobody may follow a policy that is gone
+    for (int j = 0; j < CROSS_MAX_POLICIES; j++) {
+        u8 kept = 0;
+
+        for (int k = 0; k < cross->leader_count[j]; k++)
+            if (cross->leaders[j][k].slot != slot)
+                cross->leaders[j][kept++] = cross->leaders[j][k];
+        cross->leader_count[j] = kept;
+    }
+    spin_unlock(&cross_lock);
+}
+
+// Called every sample by the owning policy; no locking
+void cross_policy_observe(int slot, u32 cpu_util)
+{
+    if (cross && slot >= 0)
+        WRITE_ONCE(cross->latest_util[slot], cpu_util);
+}
+
+// Utilization change (%) the policy's leaders predict for its next sample
+int cross_policy_term(int slot)
+{
+    int term = 0;
+
+    if (!cross || slot < 0 || !READ_ONCE(cross_policy))
+        return 0;
+
+    spin_lock(&cross_lock);
+    for (int k = 0; k < cross->leader_count[slot]; k++) {
+        struct cross_leader *leader = &cross->leaders[slot][k];
+
+        // Our next sample follows the leader's delta from lag ticks before it
+        term += leader->beta * *delta_at(cross->tick - leader->lag, leader->slot) / 100;
+    }
+    spin_unlock(&cross_lock);
+    return clamp(term, -CROSS_MAX_TERM, CROSS_MAX_TERM);
+}
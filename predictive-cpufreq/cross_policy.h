@@ -0,0 +1,22 @@
+#ifndef CROSS_POLICY_H
+#define CROSS_POLICY_H
+
+#include <linux/types.h>
+
+#define CROSS_MAX_POLICIES 64      // Policies tracked by the correlation model
+#define CROSS_MAX_LAG 3            // Longest lead, in samples
+#define CROSS_BATCH_SAMPLES 20     // Samples between correlation updates
+#define CROSS_MAX_LEADERS 2        // Leading policies used per policy
+#define CROSS_MIN_CORRELATION 25   // Minimum squared correlation (%) to use a leader
+#define CROSS_MAX_TERM 50          // Bound on the cross-policy term (%)
+
+struct dentry;
+
+int cross_policy_init(unsigned int sample_rate_ms, struct dentry *debugfs_dir);
+void cross_policy_exit(void);
+int cross_policy_register(unsigned int policy_cpu);
+void cross_policy_unregister(int slot);
+void cross_policy_observe(int slot, u32 cpu_util);
+int cross_policy_term(int slot);
+
+#endif // CROSS_POLICY_H
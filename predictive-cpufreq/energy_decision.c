@@ -0,0 +1,198 @@
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/math64.h>
+#include <linux/string.h>
+#include <linux/cpuidle.h>
+#include <linux/energy_model.h>
+#include <linux/rcupdate.h>
+#include <linux/version.h>
+#include "energy_decision.h"
+
+/*
+ * Race-to-idle versus pace-to-deadline. Proportional scaling stretches work
+ * over the whole sample period at a low OPP. That is the cheapest choice for
+ * continuous load, but when a short burst is followed by a long idle window
+ * it keeps the core out of deep C-states: finishing early at a higher OPP
+ * lets the slack join the idle window. For each OPP that completes the
+ * predicted work within the sample period, the energy of the busy part and
+ * of the resulting idle is estimated, and the cheapest OPP wins.
+ */
+static bool energy_decision;
+module_param(energy_decision, bool, 0644);
+MODULE_PARM_DESC(energy_decision, "Choose between racing to idle and pacing from per-OPP energy (default: proportional scaling)");
+
+static unsigned int deep_idle_residency_us;
+module_param(deep_idle_residency_us, uint, 0644);
+MODULE_PARM_DESC(deep_idle_residency_us, "Idle window needed for the deepest C-state, 0 to take it from cpuidle");
+
+#define DEFAULT_DEEP_RESIDENCY_US 1000
+
+bool energy_decision_enabled(void)
+{
+    return READ_ONCE(energy_decision);
+}
+
+/*
+ * Without an energy model, estimate P = C * V^2 * f + leakage(V) + uncore,
+ * with voltage rising linearly from 0.6 to 1.0 of its maximum across the
+ * frequency range. Only the ratios between OPPs matter.
+ */
+static u32 synthetic_power_mw(u32 freq, u32 min_freq, u32 max_freq)
+{
+    u64 v = 1000;   // Voltage in permille of its maximum
+    u64 dynamic;
+
+    if (max_freq > min_freq)
+        v = 600 + div_u64((u64)400 * (freq - min_freq), max_freq - min_freq);
+    dynamic = div64_u64(1000 * v * v * freq, (u64)1000000 * max_freq);
+    return (u32)(dynamic + div_u64(200 * v, 1000) + 300);
+}
+
+#if IS_ENABLED(CONFIG_ENERGY_MODEL) && LINUX_VERSION_CODE >= KERNEL_VERSION(6, 9, 0)
+// Power of the lowest energy model state at or above freq, 0 if there is none
+static u32 em_power(struct cpufreq_policy *policy, u32 freq)
+{
+    struct em_perf_domain *pd = em_cpu_get(policy->cpu);
+    struct em_perf_state *states;
+    u32 power = 0;
+
+    if (!pd)
+        return 0;
+    rcu_read_lock();
+    states = em_perf_state_from_pd(pd);
+    for (int i = 0; i < pd->nr_perf_states; i++) {
+        if (states[i].frequency >= freq) {
+            power = states[i].power;
+            break;
+        }
+    }
+    rcu_read_unlock();
+    return power;
+}
+#else
+static u32 em_power(struct cpufreq_policy *policy, u32 freq)
+{
+    return 0;
+}
+#endif
+
+static u32 cpuidle_deep_residency_us(unsigned int cpu)
+{
+#ifdef CONFIG_CPU_IDLE
+    struct cpuidle_driver *drv = cpuidle_get_cpu_driver(per_cpu(cpuidle_devices, cpu));
+
+    if (drv && drv->state_count > 1)
+        return (u32)div_u64(drv->states[drv->state_count - 1].target_residency_ns, NSEC_PER_USEC);
+#endif
+    return 0;
+}
+
+static void add_opp(energy_table_t *table, u32 freq)
+{
+    int i;
+
+    if (table->count >= ENERGY_MAX_OPPS)
+        return;
+    // freq_table need not be sorted; keep opp[] ascending
+    for (i = table->count; i > 0 && table->opp[i - 1].freq > freq; i--)
+        table->opp[i] = table->opp[i - 1];
+    table->opp[i].freq = freq;
+    table->count++;
+}
+
+void energy_table_init(energy_table_t *table, struct cpufreq_policy *policy, u32 sample_ms)
+{
+    u32 min_freq = policy->cpuinfo.min_freq;
+    u32 max_freq = policy->cpuinfo.max_freq;
+    struct cpufreq_frequency_table *pos;
+    bool use_em = true;
+
+    memset(table, 0, sizeof(*table));
+    table->sample_ms = sample_ms;
+    if (policy->freq_table) {
+        cpufreq_for_each_valid_entry(pos, policy->freq_table)
+            add_opp(table, pos->frequency);
+    } else {
+        // Continuous range (e.g. HWP): sample it in eighths
+        for (int i = 0; i <= 8; i++)
+            add_opp(table, min_freq + (max_freq - min_freq) * i / 8);
+    }
+
+    // Fall back to the synthetic model unless the energy model covers every OPP
+    for (u32 i = 0; i < table->count; i++) {
+        table->opp[i].power = em_power(policy, table->opp[i].freq);
+        if (!table->opp[i].power)
+            use_em = false;
+    }
+    if (!use_em) {
+        for (u32 i = 0; i < table->count; i++)
+            table->opp[i].power = synthetic_power_mw(table->opp[i].freq, min_freq, max_freq);
+    }
+
+    if (table->count) {
+        table->shallow_idle_power = table->opp[0].power * SHALLOW_IDLE_POWER_PCT / 100;
+        table->deep_idle_power = table->opp[0].power * DEEP_IDLE_POWER_PCT / 100;
+    }
+    table->deep_residency_us = cpuidle_deep_residency_us(policy->cpu);
+    if (!table->deep_residency_us)
+        table->deep_residency_us = DEFAULT_DEEP_RESIDENCY_US;
+}
+
+/*
+ * Frequency for util% of the sample period at cur_freq, 0 without an
+ * energy table. Busy time at another OPP scales with the frequency
+ * sensitive share of the work only. Slack in a burst that is about to end
+ * joins the predicted idle window; otherwise it is split between wakeups.
+ */
+u32 energy_decision_target(const energy_table_t *table, prediction_model_t *model,
+                           u32 cur_freq, u32 util, u32 sample_ms, bool *race)
+{
+    u64 period_us = (u64)sample_ms * USEC_PER_MSEC;
+    u64 s = model->counters_valid ? model->freq_sensitivity : 100;
+    u64 idle_after_us = div_u64(predict_idle_window_ns(model), NSEC_PER_USEC);
+    u32 residency = deep_idle_residency_us ? deep_idle_residency_us : table->deep_residency_us;
+    u64 best_energy = U64_MAX;
+    int best = -1, pace = -1;
+    u32 wakeups = 0;
+    bool joins_idle;
+
+    if (!table->count || !cur_freq)
+        return 0;
+
+    joins_idle = idle_after_us >= residency && predict_burst_samples(model) <= RACE_MAX_BURST_SAMPLES;
+    if (model->history_count >= 2) {
+        cpu_metrics_t *current = &model->history[(model->history_index - 1 + HISTORY_SIZE) % HISTORY_SIZE];
+        cpu_metrics_t *prev = &model->history[(model->history_index - 2 + HISTORY_SIZE) % HISTORY_SIZE];
+
+        wakeups = current->irq_count - prev->irq_count;
+    }
+
+    for (u32 i = 0; i < table->count; i++) {
+        const opp_energy_t *opp = &table->opp[i];
+        u64 busy_us = div64_u64(util * period_us * (s * cur_freq + (100 - s) * opp->freq),
+                                (u64)100 * 100 * opp->freq);
+        u64 slack_us, window_us, energy;
+
+        if (busy_us > period_us)
+            continue;
+        slack_us = period_us - busy_us;
+        window_us = joins_idle ? slack_us + idle_after_us : div_u64(slack_us, wakeups + 1);
+        energy = opp->power * busy_us +
+                 (window_us >= residency ? table->deep_idle_power : table->shallow_idle_power) * slack_us;
+        if (pace < 0)
+            pace = i;
+        if (energy < best_energy) {
+            best_energy = energy;
+            best = i;
+        }
+    }
+
+    // Not even the highest OPP keeps up
+    if (best < 0) {
+        *race = false;
+        return table->opp[table->count - 1].freq;
+    }
+    *race = best > pace;
+    return table->opp[best].freq;
+}
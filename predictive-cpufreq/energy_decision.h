@@ -0,0 +1,34 @@
+#ifndef ENERGY_DECISION_H
+#define ENERGY_DECISION_H
+
+#include <linux/cpufreq.h>
+#include "predictive_model.h"
+
+#define ENERGY_MAX_OPPS 32
+#define RACE_MAX_BURST_SAMPLES 2   // Bursts this short can hand their slack to the next idle window
+#define SHALLOW_IDLE_POWER_PCT 80  // Idle power without deep C-states (leakage and uncore stay on), % of lowest OPP power
+#define DEEP_IDLE_POWER_PCT 5      // Idle power in the deepest C-state, % of lowest OPP power
+
+typedef struct {
+    u32 freq;                      // KHz
+    u32 power;                     // Active power (mW, or energy model units)
+} opp_energy_t;
+
+// Per-policy energy table and decision counts
+typedef struct {
+    opp_energy_t opp[ENERGY_MAX_OPPS];    // Ascending frequency
+    u32 count;
+    u32 shallow_idle_power;
+    u32 deep_idle_power;
+    u32 deep_residency_us;                // Shortest idle window worth a deep C-state
+    u32 sample_ms;                        // Governor sample period the decisions cover
+    u32 races;                            // Chose an OPP above the lowest sufficient one
+    u32 paces;                            // Chose the lowest sufficient OPP
+} energy_table_t;
+
+bool energy_decision_enabled(void);
+void energy_table_init(energy_table_t *table, struct cpufreq_policy *policy, u32 sample_ms);
+u32 energy_decision_target(const energy_table_t *table, prediction_model_t *model,
+                           u32 cur_freq, u32 util, u32 sample_ms, bool *race);
+
+#endif // ENERGY_DECISION_H
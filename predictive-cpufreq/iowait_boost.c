@@ -0,0 +1,82 @@
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include "iowait_boost.h"
+
+/*
+ * Predictive iowait boost. The collector counts time blocked on I/O as idle,
+ * so a storage service waiting on the device is predicted at low
+ * utilization and its completions are then processed at the lowest OPP.
+ * Completions show up as iowait falling away or as a jump in interrupts;
+ * the compute run that follows each one is learned as a decaying average of
+ * its utilization and length. Once enough runs are known, the expected
+ * utilization is held as a floor while I/O is outstanding and through the
+ * expected length of the run, so the frequency is already up when the
+ * completion lands. Outside those windows the floor halves every sample.
+ */
+static unsigned int iowait_boost_cap = 75;
+module_param(iowait_boost_cap, uint, 0644);
+MODULE_PARM_DESC(iowait_boost_cap, "Highest utilization (%) the iowait boost may hold, 0 to disable");
+
+u32 iowait_boost_cap_pct(void)
+{
+    return min_t(u32, READ_ONCE(iowait_boost_cap), 100);
+}
+
+static void learn_run(iowait_boost_t *ib)
+{
+    u32 mean = ib->run_util / ib->run_samples;
+
+    if (!ib->completions) {
+        ib->completion_util = mean << IOWAIT_EWMA_SHIFT;
+        ib->completion_samples = ib->run_samples << IOWAIT_EWMA_SHIFT;
+    } else {
+        ib->completion_util += mean - (ib->completion_util >> IOWAIT_EWMA_SHIFT);
+        ib->completion_samples += ib->run_samples - (ib->completion_samples >> IOWAIT_EWMA_SHIFT);
+    }
+    ib->completions++;
+    ib->run_samples = 0;
+    ib->run_util = 0;
+}
+
+// Feed one sample; returns the utilization floor for this sample's prediction
+u32 iowait_boost_update(iowait_boost_t *ib, const cpu_metrics_t *metrics, u32 cap)
+{
+    u32 irq_delta = metrics->irq_count - ib->last_irqs;
+    bool waiting = metrics->iowait >= IOWAIT_WAIT_THRESHOLD;
+    bool completed = false;
+    u32 expected_samples;
+
+    if (ib->primed && ib->last_iowait >= IOWAIT_WAIT_THRESHOLD)
+        completed = metrics->iowait * 2 <= ib->last_iowait || irq_delta > 2 * ib->last_irq_delta;
+
+    if (ib->run_samples) {
+        if (completed || waiting || metrics->cpu_util <= IDLE_UTIL_THRESHOLD ||
+            ib->run_samples >= IOWAIT_MAX_RUN) {
+            learn_run(ib);
+        } else {
+            ib->run_samples++;
+            ib->run_util += metrics->cpu_util;
+        }
+    }
+    if (completed) {
+        ib->run_samples = 1;
+        ib->run_util = metrics->cpu_util;
+    }
+
+    expected_samples = max_t(u32, ib->completion_samples >> IOWAIT_EWMA_SHIFT, 1);
+    if (cap && ib->completions >= IOWAIT_MIN_COMPLETIONS &&
+        (waiting || (ib->run_samples && ib->run_samples <= expected_samples)))
+        ib->boost = ib->completion_util >> IOWAIT_EWMA_SHIFT;
+    else
+        ib->boost >>= 1;
+    ib->boost = min(ib->boost, cap);
+    if (ib->boost)
+        ib->boosted++;
+
+    ib->last_iowait = metrics->iowait;
+    ib->last_irqs = metrics->irq_count;
+    ib->last_irq_delta = irq_delta;
+    ib->primed = true;
+    return ib->boost;
+}
@@ -0,0 +1,29 @@
+#ifndef IOWAIT_BOOST_H
+#define IOWAIT_BOOST_H
+
+#include "predictive_model.h"
+
+#define IOWAIT_WAIT_THRESHOLD 10   // Samples with this much iowait (%) have I/O outstanding
+#define IOWAIT_MIN_COMPLETIONS 4   // Completions to learn from before boosting
+#define IOWAIT_MAX_RUN 20          // Longest compute run (samples) attributed to one completion
+#define IOWAIT_EWMA_SHIFT 3        // Learned averages move 1/8 toward each completion
+
+// Per-policy completion-to-compute history and the resulting boost
+typedef struct {
+    u32 completion_util;           // Mean utilization of the run after a completion, << IOWAIT_EWMA_SHIFT
+    u32 completion_samples;        // Length of that run, << IOWAIT_EWMA_SHIFT
+    u32 completions;               // Runs learned
+    u32 run_samples;               // Samples into the current run, 0 outside one
+    u32 run_util;                  // Utilization summed over the current run
+    u32 boost;                     // Utilization floor (%) applied to the prediction
+    u32 boosted;                   // Samples that applied a boost
+    u32 last_iowait;
+    u32 last_irqs;
+    u32 last_irq_delta;
+    bool primed;                   // last_* hold a previous sample
+} iowait_boost_t;
+
+u32 iowait_boost_cap_pct(void);
+u32 iowait_boost_update(iowait_boost_t *ib, const cpu_metrics_t *metrics, u32 cap);
+
+#endif // IOWAIT_BOOST_H
@@ -1,43 +1,159 @@
 #include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
 #include <linux/sched.h>
 #include <linux/cpufreq.h>
 #include <linux/timekeeping.h>
 #include <linux/slab.h>
+#include <linux/kernel_stat.h>
+#include <linux/percpu.h>
+#include <linux/perf_event.h>
+#include <linux/tick.h>
+#include <linux/math64.h>
 #include "metric_collector.h"
 #include "predictive_model.h"
+#include "predictive_governor.h"
 
-extern struct predictive_governor_t pred_gov;
+enum hw_counter {
+    HW_COUNTER_INSTRUCTIONS,
+    HW_COUNTER_CYCLES,
+    HW_COUNTER_LLC_MISSES,
+    HW_COUNTER_STALL_CYCLES,
+    HW_COUNTER_MAX,
+};
+
+// Per-CPU perf counters; a NULL event means the PMU does not provide it
+struct hw_counters {
+    struct perf_event *events[HW_COUNTER_MAX];
+    u64 last_value[HW_COUNTER_MAX];
+    u64 last_enabled[HW_COUNTER_MAX];
+    u64 last_running[HW_COUNTER_MAX];
+};
+
+static DEFINE_PER_CPU(struct hw_counters, hw_counters);
+
+static bool use_hw_counters = true;
+module_param(use_hw_counters, bool, 0644);
+MODULE_PARM_DESC(use_hw_counters, "Read perf hardware counters for memory-bound detection; applies to policies started afterwards");
+
+static DEFINE_PER_CPU(struct cpu_times, cpu_times);
+
+static const u64 hw_counter_config[HW_COUNTER_MAX] = {
+    [HW_COUNTER_INSTRUCTIONS] = PERF_COUNT_HW_INSTRUCTIONS,
+    [HW_COUNTER_CYCLES] = PERF_COUNT_HW_CPU_CYCLES,
+    [HW_COUNTER_LLC_MISSES] = PERF_COUNT_HW_CACHE_MISSES,
+    [HW_COUNTER_STALL_CYCLES] = PERF_COUNT_HW_STALLED_CYCLES_BACKEND,
+};
+
+/*
+ * iowait counts as idle, as in schedutil: a CPU blocked on I/O sits in idle
+ * states. io_busy = 0 gives that on the NO_HZ path and matches the jiffy
+ * fallback, which never counts iowait as busy. The iowait boost keeps the
+ * frequency up for the completions.
+ */
+static void read_cpu_times(int cpu, struct cpu_times *times)
+{
+    u64 iowait = get_cpu_iowait_time_us(cpu, NULL);
+
+    times->idle_us = get_cpu_idle_time(cpu, &times->wall_us, 0);
+    // Without NO_HZ idle accounting fall back to the tick-based counter
+    if (iowait == (u64)-1)
+        iowait = div_u64(kcpustat_cpu(cpu).cpustat[CPUTIME_IOWAIT], NSEC_PER_USEC);
+    times->iowait_us = iowait;
+    times->irqs = kstat_cpu_irqs_sum(cpu);
+}
+
+void metric_collector_init_cpu(int cpu)
+{
+#ifdef CONFIG_PERF_EVENTS
+    struct hw_counters *hc = &per_cpu(hw_counters, cpu);
+    // Not pinned: perf may multiplex them with user sessions and the NMI
+    // watchdog, and samples where they were descheduled are discarded
+    struct perf_event_attr attr = {
+        .type = PERF_TYPE_HARDWARE,
+        .size = sizeof(attr),
+    };
+
+    for (int i = 0; i < HW_COUNTER_MAX; i++) {
+        struct perf_event *event;
+
+        hc->events[i] = NULL;
+        if (!READ_ONCE(use_hw_counters))
+            continue;
+        attr.config = hw_counter_config[i];
+        event = perf_event_create_kernel_counter(&attr, cpu, NULL, NULL, NULL);
+        hc->events[i] = IS_ERR(event) ? NULL : event;
+        if (hc->events[i])
+            hc->last_value[i] = perf_event_read_value(event, &hc->last_enabled[i],
+                                                      &hc->last_running[i]);
+    }
+#endif
+    read_cpu_times(cpu, &per_cpu(cpu_times, cpu));
+}
+
+void metric_collector_exit_cpu(int cpu)
+{
+#ifdef CONFIG_PERF_EVENTS
+    struct hw_counters *hc = &per_cpu(hw_counters, cpu);
+
+    for (int i = 0; i < HW_COUNTER_MAX; i++) {
+        if (hc->events[i])
+            perf_event_release_kernel(hc->events[i]);
+        hc->events[i] = NULL;
+    }
+#endif
+}
+
+/*
+ * Read counter deltas into metrics. Instructions and cycles are required;
+ * a counter that was descheduled for part of the sample (VM without a
+ * virtual PMU, contention with other perf users) invalidates the sample.
+ */
+static void collect_hw_counters(int cpu, cpu_metrics_t *metrics)
+{
+    struct hw_counters *hc = &per_cpu(hw_counters, cpu);
+    u64 delta[HW_COUNTER_MAX] = { 0 };
+    bool valid = hc->events[HW_COUNTER_INSTRUCTIONS] && hc->events[HW_COUNTER_CYCLES];
+
+    metrics->counters_valid = false;
+
+#ifdef CONFIG_PERF_EVENTS
+    for (int i = 0; i < HW_COUNTER_MAX; i++) {
+        u64 value, enabled, running;
+
+        if (!hc->events[i])
+            continue;
+        value = perf_event_read_value(hc->events[i], &enabled, &running);
+        delta[i] = value - hc->last_value[i];
+        if (!hw_counter_sample_valid(enabled - hc->last_enabled[i], running - hc->last_running[i]))
+            valid = false;
+        hc->last_value[i] = value;
+        hc->last_enabled[i] = enabled;
+        hc->last_running[i] = running;
+    }
+#endif
+
+    metrics->instructions = delta[HW_COUNTER_INSTRUCTIONS];
+    metrics->cycles = delta[HW_COUNTER_CYCLES];
+    metrics->llc_misses = delta[HW_COUNTER_LLC_MISSES];
+    metrics->stall_cycles = delta[HW_COUNTER_STALL_CYCLES];
+    metrics->counters_valid = valid;
+}
 
 void collect_cpu_metrics(int cpu, cpu_metrics_t *metrics)
 {
+    struct cpu_times *prev = &per_cpu(cpu_times, cpu);
+    struct cpu_times now_times;
     u64 now = ktime_get_ns();
-    struct kernel_cpustat *kstat = &kcpustat_cpu(cpu);
-    u64 user, nice, system, idle, iowait, irq, softirq, steal;
-    u64 total;
 
     metrics->timestamp = now;
     metrics->freq = pred_gov.cpu_data[cpu]->policy->cur;
 
-    user = kstat->cpustat[CPUTIME_USER];
-    nice = kstat->cpustat[CPUTIME_NICE];
-    system = kstat->cpustat[CPUTIME_SYSTEM];
-    idle = kstat->cpustat[CPUTIME_IDLE];
-    iowait = kstat->cpustat[CPUTIME_IOWAIT];
-    irq = kstat->cpustat[CPUTIME_IRQ];
-    softirq = kstat->cpustat[CPUTIME_SOFTIRQ];
-    steal = kstat->cpustat[CPUTIME_STEAL];
-
-    total = user + nice + system + idle + iowait + irq + softirq + steal;
-    if (total > 0) {
-        metrics->cpu_util = (u32)((100 * (total - idle)) / total);
-        metrics->iowait = (u32)((100 * iowait) / total);
-    } else {
-        metrics->cpu_util = 0;
-        metrics->iowait = 0;
-    }
+    read_cpu_times(cpu, &now_times);
+    cpu_times_to_metrics(prev, &now_times, metrics);
+    *prev = now_times;
 
-    metrics->irq_count = kstat_irqs_cpu(0, cpu); // Simplified for example
     metrics->runnable_tasks = nr_running();
-    metrics->idle_time = idle - pred_gov.cpu_data[cpu]->model.history[(pred_gov.cpu_data[cpu]->model.history_index - 1 + HISTORY_SIZE) % HISTORY_SIZE].idle_time;
+    collect_hw_counters(cpu, metrics);
     pred_gov.cpu_data[cpu]->last_sample_time = now;
 }
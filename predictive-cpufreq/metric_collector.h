@@ -1,8 +1,45 @@
 #ifndef METRIC_COLLECTOR_H
 #define METRIC_COLLECTOR_H
 
+#include <linux/kernel.h>
+#include <linux/math64.h>
 #include "predictive_model.h"
 
+// Cumulative CPU time at the previous sample; metrics are deltas against it
+struct cpu_times {
+    u64 wall_us;
+    u64 idle_us;                  // Includes iowait
+    u64 iowait_us;
+    u64 irqs;
+};
+
+// Utilization, iowait, idle time and interrupt count between two readings
+static inline void cpu_times_to_metrics(const struct cpu_times *prev, const struct cpu_times *now,
+                                        cpu_metrics_t *metrics)
+{
+    u64 wall = now->wall_us - prev->wall_us;
+    u64 idle = min(now->idle_us - prev->idle_us, wall);
+    u64 iowait = min(now->iowait_us - prev->iowait_us, wall);
+
+    if (wall > 0) {
+        metrics->cpu_util = (u32)div64_u64(100 * (wall - idle), wall);
+        metrics->iowait = (u32)div64_u64(100 * iowait, wall);
+    } else {
+        metrics->cpu_util = 0;
+        metrics->iowait = 0;
+    }
+    metrics->idle_time = idle * NSEC_PER_USEC;
+    metrics->irq_count = (u32)now->irqs;
+}
+
+// A counter descheduled for more than 5% of the sample gives no usable delta
+static inline bool hw_counter_sample_valid(u64 enabled_delta, u64 running_delta)
+{
+    return running_delta * 100 >= enabled_delta * 95;
+}
+
 void collect_cpu_metrics(int cpu, cpu_metrics_t *metrics);
+void metric_collector_init_cpu(int cpu);
+void metric_collector_exit_cpu(int cpu);
 
 #endif // METRIC_COLLECTOR_H
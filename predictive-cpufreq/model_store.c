@@ -0,0 +1,197 @@
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/err.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/cpumask.h>
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/uaccess.h>
+#include "predictive_model.h"
+#include "model_store.h"
+
+/*
+ * Learned model state per policy, kept for the lifetime of the module so
+ * that governor switches, stop/start and CPU hotplug don't throw away what
+ * the model has learned. Entries are keyed by the first CPU of the policy's
+ * related_cpus, which stays the same while policy->cpu moves on hotplug.
+ *
+ * debugfs exposes each entry as predictive_cpufreq/policyN/model_state:
+ * reading exports the last saved state, writing a state imports it into the
+ * running model at its next sample, or at the next governor start.
+ */
+struct model_store_entry {
+    prediction_model_state_t state;
+    bool valid;                           // state holds a saved model
+    bool import_pending;                  // state was written from user space
+    spinlock_t lock;
+    struct dentry *dir;
+};
+
+static struct model_store_entry **model_store;
+static struct dentry *model_store_debugfs;
+static DEFINE_SPINLOCK(model_store_lock);
+
+static ssize_t model_state_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+{
+    struct model_store_entry *entry = file->private_data;
+    prediction_model_state_t *state;
+    ssize_t ret = 0;
+
+    state = kmalloc(sizeof(*state), GFP_KERNEL);
+    if (!state)
+        return -ENOMEM;
+
+    spin_lock(&entry->lock);
+    if (entry->valid) {
+        *state = entry->state;
+        ret = sizeof(*state);
+    }
+    spin_unlock(&entry->lock);
+
+    if (ret)
+        ret = simple_read_from_buffer(buf, count, ppos, state, sizeof(*state));
+    kfree(state);
+    return ret;
+}
+
+static ssize_t model_state_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
+{
+    struct model_store_entry *entry = file->private_data;
+    prediction_model_state_t *state;
+
+    if (*ppos != 0 || count != sizeof(*state))
+        return -EINVAL;
+
+    state = memdup_user(buf, count);
+    if (IS_ERR(state))
+        return PTR_ERR(state);
+    if (!model_state_valid(state)) {
+        kfree(state);
+        return -EINVAL;
+    }
+
+    spin_lock(&entry->lock);
+    entry->state = *state;
+    entry->valid = true;
+    entry->import_pending = true;
+    spin_unlock(&entry->lock);
+
+    kfree(state);
+    *ppos += count;
+    return count;
+}
+
+static const struct file_operations model_state_fops = {
+    .owner = THIS_MODULE,
+    .open = simple_open,
+    .read = model_state_read,
+    .write = model_state_write,
+    .llseek = default_llseek,
+};
+
+int model_store_init(void)
+{
+    model_store = kcalloc(nr_cpu_ids, sizeof(*model_store), GFP_KERNEL);
+    if (!model_store)
+        return -ENOMEM;
+    model_store_debugfs = debugfs_create_dir("predictive_cpufreq", NULL);
+    return 0;
+}
+
+void model_store_exit(void)
+{
+    debugfs_remove_recursive(model_store_debugfs);
+    for (unsigned int cpu = 0; cpu < nr_cpu_ids; cpu++)
+        kfree(model_store[cpu]);
+    kfree(model_store);
+    model_store = NULL;
+}
+
+// Find or create the entry for a policy; NULL means run without persistence
+struct model_store_entry *model_store_get(struct cpufreq_policy *policy)
+{
+    unsigned int key = cpumask_first(policy->related_cpus);
+    struct model_store_entry *entry, *new_entry;
+    char name[16];
+
+    if (!model_store || key >= nr_cpu_ids)
+        return NULL;
+
+    spin_lock(&model_store_lock);
+    entry = model_store[key];
+    spin_unlock(&model_store_lock);
+    if (entry)
+        return entry;
+
+    new_entry = kzalloc(sizeof(*new_entry), GFP_KERNEL);
+    if (!new_entry)
+        return NULL;
+    spin_lock_init(&new_entry->lock);
+
+    spin_lock(&model_store_lock);
+    entry = model_store[key];
+    if (!entry)
+        model_store[key] = entry = new_entry;
+    spin_unlock(&model_store_lock);
+
+    if (entry != new_entry) {
+        kfree(new_entry);
+        return entry;
+    }
+
+    snprintf(name, sizeof(name), "policy%u", key);
+    entry->dir = debugfs_create_dir(name, model_store_debugfs);
+    debugfs_create_file("model_state", 0600, entry->dir, entry, &model_state_fops);
+    return entry;
+}
+
+// Warm-start a freshly initialized model; false if nothing was saved
+bool model_store_restore(struct model_store_entry *entry, prediction_model_t *model)
+{
+    bool restored = false;
+
+    if (!entry)
+        return false;
+
+    spin_lock(&entry->lock);
+    if (entry->valid)
+        restored = restore_model_state(model, &entry->state) == 0;
+    entry->import_pending = false;
+    spin_unlock(&entry->lock);
+    return restored;
+}
+
+void model_store_save(struct model_store_entry *entry, const prediction_model_t *model)
+{
+    if (!entry)
+        return;
+
+    spin_lock(&entry->lock);
+    // An import that the model hasn't picked up yet wins over the old model
+    if (!entry->import_pending) {
+        save_model_state(model, &entry->state);
+        entry->valid = true;
+    }
+    spin_unlock(&entry->lock);
+}
+
+// Called every sample, so the common no-import case takes no lock
+bool model_store_apply_import(struct model_store_entry *entry, prediction_model_t *model)
+{
+    if (!entry || !READ_ONCE(entry->import_pending))
+        return false;
+    return model_store_restore(entry, model);
+}
+
+// Per-policy debugfs directory, shared with other per-policy statistics
+struct dentry *model_store_debugfs_dir(struct model_store_entry *entry)
+{
+    return entry ? entry->dir : NULL;
+}
+
+// Top-level predictive_cpufreq debugfs directory
+struct dentry *model_store_debugfs_root(void)
+{
+    return model_store_debugfs;
+}
@@ -0,0 +1,20 @@
+#ifndef MODEL_STORE_H
+#define MODEL_STORE_H
+
+#include <linux/cpufreq.h>
+#include "predictive_model.h"
+
+#define MODEL_CHECKPOINT_SAMPLES 100  // Samples between checkpoints of a live model
+
+struct model_store_entry;
+
+int model_store_init(void);
+void model_store_exit(void);
+struct model_store_entry *model_store_get(struct cpufreq_policy *policy);
+bool model_store_restore(struct model_store_entry *entry, prediction_model_t *model);
+void model_store_save(struct model_store_entry *entry, const prediction_model_t *model);
+bool model_store_apply_import(struct model_store_entry *entry, prediction_model_t *model);
+struct dentry *model_store_debugfs_dir(struct model_store_entry *entry);
+struct dentry *model_store_debugfs_root(void);
+
+#endif // MODEL_STORE_H
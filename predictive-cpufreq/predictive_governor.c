@@ -4,97 +4,214 @@
 #include <linux/slab.h>
 #include <linux/workqueue.h>
 #include <linux/spinlock.h>
+#include <linux/mutex.h>
 #include <linux/timekeeping.h>
+#include <linux/jiffies.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
+#include <linux/irq_work.h>
 #include "predictive_model.h"
+#include "predictive_governor.h"
 #include "metric_collector.h"
 #include "pattern_recognizer.h"
+#include "model_store.h"
+#include "cross_policy.h"
+#include "task_migration.h"
 
-// Per-CPU governor state
-typedef struct {
-    prediction_model_t model;
-    u32 target_freq;
-    u32 last_freq;
-    u64 last_sample_time;
-    struct delayed_work work;
-    struct cpufreq_policy *policy;
-    spinlock_t lock;
-} predictive_cpu_data_t;
-
-// Global governor state
-typedef struct {
-    predictive_cpu_data_t **cpu_data;
-    u32 enabled;
-    u32 sample_rate_ms;
-    u32 min_freq_change_threshold;
-} predictive_governor_t;
-
-static predictive_governor_t pred_gov;
+predictive_governor_t pred_gov;
+
+static unsigned int target_quantile = 50;
+module_param(target_quantile, uint, 0644);
+MODULE_PARM_DESC(target_quantile, "Quantile of predicted utilization to provision for: 50 for batch, 95 for latency-sensitive");
 
 static void predictive_sampling_work(struct work_struct *work);
+static void predictive_migration_work(struct work_struct *work);
 static int predictive_cpufreq_init(struct cpufreq_policy *policy);
 static void predictive_cpufreq_exit(struct cpufreq_policy *policy);
 static int predictive_cpufreq_start(struct cpufreq_policy *policy);
 static void predictive_cpufreq_stop(struct cpufreq_policy *policy);
 static void predictive_cpufreq_limits(struct cpufreq_policy *policy);
-u32 calculate_target_frequency(struct cpufreq_policy *policy, u32 predicted_util, prediction_model_t *model);
+
+// Queued by the migration probe; migrations inside the interval fold into one kick
+static void predictive_migration_kick(struct irq_work *work)
+{
+    predictive_cpu_data_t *cpu_data = container_of(work, predictive_cpu_data_t, migration_kick);
+    u64 interval = div_u64((u64)pred_gov.sample_rate_ms * NSEC_PER_MSEC, MIGRATION_KICK_DIVISOR);
+    u64 elapsed = ktime_get_ns() - READ_ONCE(cpu_data->last_kick_ns);
+    unsigned long delay = 0;
+
+    if (elapsed < interval)
+        delay = nsecs_to_jiffies(interval - elapsed);
+    queue_delayed_work(system_wq, &cpu_data->migration_work, delay);
+}
+
+// Latest prediction with its p5-p95 interval, predictive_cpufreq/policyN/prediction
+static int prediction_show(struct seq_file *m, void *v)
+{
+    predictive_cpu_data_t *cpu_data = m->private;
+    prediction_model_t *model = &cpu_data->model;
+    unsigned long flags;
+    u32 low, high;
+
+    spin_lock_irqsave(&cpu_data->lock, flags);
+    prediction_interval(model, model->last_prediction, &low, &high);
+    seq_printf(m, "prediction: %u\n", model->last_prediction);
+    seq_printf(m, "interval_p5_p95: %u %u\n", low, high);
+    seq_printf(m, "target_quantile: %u\n", model->target_quantile);
+    seq_printf(m, "provisioned_util: %u\n",
+               predict_utilization_quantile(model, model->last_prediction, model->target_quantile));
+    seq_printf(m, "residual_samples: %u\n", model->residual_weight / RESIDUAL_WEIGHT);
+    seq_printf(m, "avg_prediction_error: %u\n", model->avg_prediction_error);
+    seq_printf(m, "burst_samples: %u\n", predict_burst_samples(model));
+    seq_printf(m, "idle_window_us: %llu\n", div_u64(predict_idle_window_ns(model), NSEC_PER_USEC));
+    seq_printf(m, "energy_races: %u\n", cpu_data->energy.races);
+    seq_printf(m, "energy_paces: %u\n", cpu_data->energy.paces);
+    seq_printf(m, "migration_term: %d\n", model->migration_term);
+    seq_printf(m, "iowait_boost: %u\n", cpu_data->iowait.boost);
+    seq_printf(m, "iowait_completions: %u\n", cpu_data->iowait.completions);
+    seq_printf(m, "iowait_completion_util: %u\n", cpu_data->iowait.completion_util >> IOWAIT_EWMA_SHIFT);
+    seq_printf(m, "iowait_boosted_samples: %u\n", cpu_data->iowait.boosted);
+    spin_unlock_irqrestore(&cpu_data->lock, flags);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(prediction);
+
+static struct dentry *create_prediction_file(predictive_cpu_data_t *cpu_data)
+{
+    struct dentry *dir = model_store_debugfs_dir(cpu_data->store);
+
+    if (!dir)
+        return NULL;
+    return debugfs_create_file("prediction", 0444, dir, cpu_data, &prediction_fops);
+}
 
 static int predictive_cpufreq_init(struct cpufreq_policy *policy)
 {
     predictive_cpu_data_t *cpu_data;
-    int cpu = policy->cpu;
+    if (!pred_gov.cpu_data)
+        return -EINVAL;
     cpu_data = kzalloc(sizeof(*cpu_data), GFP_KERNEL);
     if (!cpu_data)
         return -ENOMEM;
     spin_lock_init(&cpu_data->lock);
+    mutex_init(&cpu_data->update_lock);
     cpu_data->policy = policy;
     cpu_data->last_freq = policy->cur;
     cpu_data->target_freq = policy->cur;
     cpu_data->last_sample_time = ktime_get_ns();
     init_prediction_model(&cpu_data->model);
-    if (!pred_gov.cpu_data)
-        return -EINVAL;
-    pred_gov.cpu_data[cpu] = cpu_data;
+    // Pick up where the last governor instance on this policy left off
+    cpu_data->store = model_store_get(policy);
+    model_store_restore(cpu_data->store, &cpu_data->model);
+    cpu_data->model.target_quantile = min_t(u32, target_quantile, 100);
+    cpu_data->shadows = create_shadow_models(&cpu_data->shadow_count);
+    cpu_data->shadow_stats = create_shadow_stats_file(cpu_data);
+    cpu_data->prediction_file = create_prediction_file(cpu_data);
+    cpu_data->cross_slot = -1;
+    energy_table_init(&cpu_data->energy, policy, pred_gov.sample_rate_ms);
     INIT_DEFERRABLE_WORK(&cpu_data->work, predictive_sampling_work);
-    mod_delayed_work(system_wq, &cpu_data->work, msecs_to_jiffies(pred_gov.sample_rate_ms));
+    INIT_DELAYED_WORK(&cpu_data->migration_work, predictive_migration_work);
+    init_irq_work(&cpu_data->migration_kick, predictive_migration_kick);
+    policy->governor_data = cpu_data;
     return 0;
 }
 
 static void predictive_cpufreq_exit(struct cpufreq_policy *policy)
 {
-    predictive_cpu_data_t *cpu_data = pred_gov.cpu_data[policy->cpu];
+    predictive_cpu_data_t *cpu_data = policy->governor_data;
     if (cpu_data) {
-        cancel_delayed_work_sync(&cpu_data->work);
+        model_store_save(cpu_data->store, &cpu_data->model);
+        debugfs_remove(cpu_data->shadow_stats);
+        debugfs_remove(cpu_data->prediction_file);
+        policy->governor_data = NULL;
+        kfree(cpu_data->shadows);
         kfree(cpu_data);
-        pred_gov.cpu_data[policy->cpu] = NULL;
     }
 }
 
+// policy->cpu can change across stop/start when CPUs go offline
 static int predictive_cpufreq_start(struct cpufreq_policy *policy)
 {
-    predictive_cpu_data_t *cpu_data = pred_gov.cpu_data[policy->cpu];
+    predictive_cpu_data_t *cpu_data = policy->governor_data;
     if (!cpu_data)
         return -EINVAL;
+    cpu_data->cpu = policy->cpu;
+    pred_gov.cpu_data[cpu_data->cpu] = cpu_data;
+    metric_collector_init_cpu(cpu_data->cpu);
+    cpu_data->cross_slot = cross_policy_register(cpumask_first(policy->related_cpus));
+    task_migration_register(policy, &cpu_data->migration_kick);
     mod_delayed_work(system_wq, &cpu_data->work, msecs_to_jiffies(pred_gov.sample_rate_ms));
     return 0;
 }
 
 static void predictive_cpufreq_stop(struct cpufreq_policy *policy)
 {
-    predictive_cpu_data_t *cpu_data = pred_gov.cpu_data[policy->cpu];
+    predictive_cpu_data_t *cpu_data = policy->governor_data;
     if (cpu_data) {
+        // The kick queues migration_work, so retire it first
+        task_migration_unregister(policy, &cpu_data->migration_kick);
+        cancel_delayed_work_sync(&cpu_data->migration_work);
         cancel_delayed_work_sync(&cpu_data->work);
+        metric_collector_exit_cpu(cpu_data->cpu);
+        cross_policy_unregister(cpu_data->cross_slot);
+        cpu_data->cross_slot = -1;
+        pred_gov.cpu_data[cpu_data->cpu] = NULL;
+        model_store_save(cpu_data->store, &cpu_data->model);
     }
 }
 
 static void predictive_cpufreq_limits(struct cpufreq_policy *policy)
 {
-    predictive_cpu_data_t *cpu_data = pred_gov.cpu_data[policy->cpu];
+    predictive_cpu_data_t *cpu_data = policy->governor_data;
     if (cpu_data) {
+        mutex_lock(&cpu_data->update_lock);
         if (policy->cur < policy->min)
             __cpufreq_driver_target(policy, policy->min, CPUFREQ_RELATION_L);
         else if (policy->cur > policy->max)
             __cpufreq_driver_target(policy, policy->max, CPUFREQ_RELATION_H);
+        mutex_unlock(&cpu_data->update_lock);
+    }
+}
+
+/*
+ * Re-target with the utilization migrated in since the last sample, without
+ * adding a sample: the history stays at the fixed period the trend, run
+ * lengths and scoring assume. Only arrivals raise the frequency early; the
+ * next sample accounts for departures.
+ */
+static void predictive_migration_work(struct work_struct *work)
+{
+    predictive_cpu_data_t *cpu_data = container_of(work, predictive_cpu_data_t, migration_work.work);
+    struct cpufreq_policy *policy = cpu_data->policy;
+    thermal_snapshot_t thermal;
+    u32 util, target_freq, burst_ms;
+    unsigned long flags;
+    bool update = false;
+    int term;
+
+    thermal_budget_read(&thermal);
+    mutex_lock(&cpu_data->update_lock);
+    spin_lock_irqsave(&cpu_data->lock, flags);
+    WRITE_ONCE(cpu_data->last_kick_ns, ktime_get_ns());
+    term = task_migration_kick_term(policy);
+    if (term > 0) {
+        cpu_data->model.migration_term = term;
+        util = min_t(u32, cpu_data->model.last_prediction + term, 100);
+        target_freq = calculate_target_frequency(policy, util, &cpu_data->model);
+        burst_ms = predict_burst_samples(&cpu_data->model) * pred_gov.sample_rate_ms;
+        target_freq = thermal_budget_cap(&cpu_data->thermal, &thermal, policy, target_freq, burst_ms);
+        update = target_freq > cpu_data->last_freq + pred_gov.min_freq_change_threshold;
+        if (update) {
+            cpu_data->target_freq = target_freq;
+            cpu_data->last_freq = target_freq;
+        }
     }
+    spin_unlock_irqrestore(&cpu_data->lock, flags);
+    // The driver may sleep; update_lock keeps the sampling work from interleaving
+    if (update)
+        __cpufreq_driver_target(policy, target_freq, CPUFREQ_RELATION_L);
+    mutex_unlock(&cpu_data->update_lock);
 }
 
 static void predictive_sampling_work(struct work_struct *work)
@@ -102,42 +219,54 @@ static void predictive_sampling_work(struct work_struct *work)
     predictive_cpu_data_t *cpu_data = container_of(work, predictive_cpu_data_t, work.work);
     struct cpufreq_policy *policy = cpu_data->policy;
     cpu_metrics_t metrics;
-    u32 predicted_util, target_freq;
+    thermal_snapshot_t thermal;
+    u32 predicted_util, boost_util, model_freq, target_freq, burst_ms;
     unsigned long flags;
+    bool update;
     collect_cpu_metrics(policy->cpu, &metrics);
+    thermal_budget_read(&thermal);
+    mutex_lock(&cpu_data->update_lock);
     spin_lock_irqsave(&cpu_data->lock, flags);
+    model_store_apply_import(cpu_data->store, &cpu_data->model);
+    score_prediction(&cpu_data->score, &metrics, policy->cpuinfo.max_freq);
     add_metrics_to_history(&cpu_data->model, &metrics);
+    cross_policy_observe(cpu_data->cross_slot, metrics.cpu_util);
+    cpu_data->model.cross_policy_term = cross_policy_term(cpu_data->cross_slot);
+    cpu_data->model.migration_term = task_migration_sample_term(policy);
     predicted_util = predict_cpu_utilization(&cpu_data->model);
-    target_freq = calculate_target_frequency(policy, predicted_util, &cpu_data->model);
-    if (abs(target_freq - cpu_data->last_freq) > pred_gov.min_freq_change_threshold) {
+    // Scored like the shadows, before the adjustments below that they never see
+    model_freq = calculate_target_frequency(policy, predicted_util, &cpu_data->model);
+    // Keep the frequency up for the compute that follows outstanding I/O
+    boost_util = iowait_boost_update(&cpu_data->iowait, &metrics, iowait_boost_cap_pct());
+    target_freq = model_freq;
+    if (boost_util > predicted_util)
+        target_freq = max(target_freq, util_floor_frequency(policy, boost_util));
+    // Spread the thermal headroom over the rest of the burst instead of throttling midway
+    thermal_budget_observe(&cpu_data->thermal, &thermal, policy->cur, policy->cpuinfo.max_freq);
+    burst_ms = predict_burst_samples(&cpu_data->model) * pred_gov.sample_rate_ms;
+    target_freq = thermal_budget_cap(&cpu_data->thermal, &thermal, policy, target_freq, burst_ms);
+    update = abs(target_freq - cpu_data->last_freq) > pred_gov.min_freq_change_threshold;
+    if (update) {
         cpu_data->target_freq = target_freq;
-        __cpufreq_driver_target(policy, target_freq, CPUFREQ_RELATION_L);
         cpu_data->last_freq = target_freq;
     }
+    record_prediction(&cpu_data->score, predicted_util, model_freq);
+    sample_shadow_models(cpu_data->shadows, cpu_data->shadow_count, policy, &metrics);
     if (cpu_data->model.predictions_made % 100 == 0) {
         update_patterns(&cpu_data->model);
     }
+    if (++cpu_data->samples_since_checkpoint >= MODEL_CHECKPOINT_SAMPLES) {
+        model_store_save(cpu_data->store, &cpu_data->model);
+        cpu_data->samples_since_checkpoint = 0;
+    }
     spin_unlock_irqrestore(&cpu_data->lock, flags);
+    // The driver may sleep, so change frequency only after dropping the spinlock
+    if (update)
+        __cpufreq_driver_target(policy, target_freq, CPUFREQ_RELATION_L);
+    mutex_unlock(&cpu_data->update_lock);
     mod_delayed_work(system_wq, &cpu_data->work, msecs_to_jiffies(pred_gov.sample_rate_ms));
 }
 
-u32 calculate_target_frequency(struct cpufreq_policy *policy, u32 predicted_util, prediction_model_t *model)
-{
-    u32 min_freq = policy->cpuinfo.min_freq;
-    u32 max_freq = policy->cpuinfo.max_freq;
-    u32 range = max_freq - min_freq;
-    u32 adjusted_util = predicted_util;
-    if (model->aggressiveness > 50) {
-        adjusted_util = predicted_util + ((model->aggressiveness - 50) * predicted_util) / 100;
-    } else if (model->aggressiveness < 50) {
-        adjusted_util = predicted_util * model->aggressiveness / 50;
-    }
-    if (adjusted_util > 100)
-        adjusted_util = 100;
-    u32 target_freq = min_freq + (range * adjusted_util) / 100;
-    return cpufreq_frequency_table_target(policy, policy->freq_table, target_freq, CPUFREQ_RELATION_L);
-}
-
 static struct cpufreq_governor predictive_governor = {
     .name = "predictive",
     .owner = THIS_MODULE,
@@ -157,8 +286,29 @@ static int __init predictive_governor_init(void)
     pred_gov.enabled = 0;
     pred_gov.sample_rate_ms = 50;
     pred_gov.min_freq_change_threshold = 100000;
+    ret = model_store_init();
+    if (ret) {
+        kfree(pred_gov.cpu_data);
+        return ret;
+    }
+    ret = cross_policy_init(pred_gov.sample_rate_ms, model_store_debugfs_root());
+    if (ret) {
+        model_store_exit();
+        kfree(pred_gov.cpu_data);
+        return ret;
+    }
+    ret = task_migration_init();
+    if (ret) {
+        cross_policy_exit();
+        model_store_exit();
+        kfree(pred_gov.cpu_data);
+        return ret;
+    }
     ret = cpufreq_register_governor(&predictive_governor);
     if (ret) {
+        task_migration_exit();
+        cross_policy_exit();
+        model_store_exit();
         kfree(pred_gov.cpu_data);
         return ret;
     }
@@ -168,6 +318,9 @@ static int __init predictive_governor_init(void)
 static void __exit predictive_governor_exit(void)
 {
     cpufreq_unregister_governor(&predictive_governor);
+    task_migration_exit();
+    cross_policy_exit();
+    model_store_exit();
     kfree(pred_gov.cpu_data);
 }
 
@@ -0,0 +1,56 @@
+#ifndef PREDICTIVE_GOVERNOR_H
+#define PREDICTIVE_GOVERNOR_H
+
+#include <linux/cpufreq.h>
+#include <linux/workqueue.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/irq_work.h>
+#include "predictive_model.h"
+#include "model_store.h"
+#include "shadow_model.h"
+#include "thermal_budget.h"
+#include "energy_decision.h"
+#include "target_frequency.h"
+#include "iowait_boost.h"
+
+// Per-CPU governor state
+typedef struct {
+    prediction_model_t model;
+    u32 target_freq;
+    u32 last_freq;
+    u64 last_sample_time;
+    struct delayed_work work;
+    struct cpufreq_policy *policy;
+    spinlock_t lock;
+    struct mutex update_lock;             // Serialises target changes, held outside lock
+    unsigned int cpu;                     // Index in pred_gov.cpu_data while started
+    struct model_store_entry *store;      // Persistent model state, may be NULL
+    u32 samples_since_checkpoint;
+    shadow_score_t score;                 // Primary model, scored like the shadows
+    shadow_model_t *shadows;              // Evaluated but never applied
+    u32 shadow_count;
+    struct dentry *shadow_stats;
+    struct dentry *prediction_file;
+    int cross_slot;                       // Slot in the cross-policy model, -1 if none
+    thermal_policy_t thermal;             // Learned heating rates for thermal capping
+    energy_table_t energy;                // Per-OPP power for race-to-idle decisions
+    struct irq_work migration_kick;       // Queued by the probe when a heavy task migrates in
+    struct delayed_work migration_work;   // Re-targets on a kick, rate limited
+    u64 last_kick_ns;
+    iowait_boost_t iowait;                // Learned compute after I/O completions
+} predictive_cpu_data_t;
+
+// Global governor state
+typedef struct {
+    predictive_cpu_data_t **cpu_data;
+    u32 enabled;
+    u32 sample_rate_ms;
+    u32 min_freq_change_threshold;
+} predictive_governor_t;
+
+extern predictive_governor_t pred_gov;
+
+struct dentry *create_shadow_stats_file(predictive_cpu_data_t *cpu_data);
+
+#endif // PREDICTIVE_GOVERNOR_H
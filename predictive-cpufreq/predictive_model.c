@@ -1,5 +1,7 @@
 #include <linux/kernel.h>
+#include <linux/errno.h>
 #include <linux/string.h>
+#include <linux/math64.h>
 #include "predictive_model.h"
 
 void init_prediction_model(prediction_model_t *model)
@@ -8,13 +10,84 @@ void init_prediction_model(prediction_model_t *model)
     model->prediction_window = PREDICTION_WINDOW_MS;
     model->aggressiveness = 50;  // Medium aggressiveness by default
     model->learning_rate = 10;   // Learning rate percentage
+    model->min_perf_gain = 5;    // Raise frequency only for >5% predicted speedup
+    model->llc_miss_penalty = 100;
+    model->freq_sensitivity = 100;
+    model->target_quantile = 50;
     model->history_index = 0;
     model->history_count = 0;
     model->pattern_count = 0;
 }
 
+/*
+ * Estimate which share of the last sample's runtime scales with core
+ * frequency. Cycles stalled on memory take the same wall time at any OPP.
+ */
+static void update_frequency_sensitivity(prediction_model_t *model, cpu_metrics_t *metrics)
+{
+    u64 stall_cycles;
+    u32 stall_pct, sensitivity;
+
+    model->counters_valid = metrics->counters_valid && metrics->cycles && metrics->instructions;
+    if (!model->counters_valid)
+        return;
+
+    if (metrics->stall_cycles)
+        stall_cycles = metrics->stall_cycles;
+    else
+        stall_cycles = metrics->llc_misses * model->llc_miss_penalty;
+
+    stall_pct = (u32)min_t(u64, div64_u64(stall_cycles * 100, metrics->cycles), 100);
+    sensitivity = 100 - stall_pct;
+    model->freq_sensitivity = (model->freq_sensitivity * (100 - model->learning_rate) +
+                               sensitivity * model->learning_rate) / 100;
+}
+
+/*
+ * Add the residual of the pending prediction to the histogram. Old
+ * residuals fade out by halving all buckets, so the quantiles follow
+ * changes in how predictable the load is.
+ */
+static void update_residuals(prediction_model_t *model, cpu_metrics_t *metrics)
+{
+    int residual, bucket;
+
+    if (!model->prediction_pending)
+        return;
+    model->prediction_pending = false;
+
+    residual = (int)metrics->cpu_util - (int)model->last_prediction;
+    bucket = clamp((residual + 100 + 2) / 5, 0, RESIDUAL_BUCKETS - 1);
+    model->residual_hist[bucket] += RESIDUAL_WEIGHT;
+    model->residual_weight += RESIDUAL_WEIGHT;
+
+    if (model->residual_weight > RESIDUAL_MAX_WEIGHT) {
+        model->residual_weight = 0;
+        for (int i = 0; i < RESIDUAL_BUCKETS; i++) {
+            model->residual_hist[i] /= 2;
+            model->residual_weight += model->residual_hist[i];
+        }
+    }
+
+    if (abs(residual) > 20)
+        model->prediction_errors++;
+    model->avg_prediction_error = (model->avg_prediction_error * (100 - model->learning_rate) +
+                                   abs(residual) * model->learning_rate) / 100;
+}
+
+// Remember a prediction so its residual can be scored on the next sample
+static u32 note_prediction(prediction_model_t *model, u32 prediction)
+{
+    model->last_prediction = prediction;
+    model->prediction_pending = true;
+    return prediction;
+}
+
 void add_metrics_to_history(prediction_model_t *model, cpu_metrics_t *metrics)
 {
+    update_frequency_sensitivity(model, metrics);
+    update_residuals(model, metrics);
+
     model->history[model->history_index] = *metrics;
     model->history_index = (model->history_index + 1) % HISTORY_SIZE;
     if (model->history_count < HISTORY_SIZE)
@@ -23,8 +96,9 @@ void add_metrics_to_history(prediction_model_t *model, cpu_metrics_t *metrics)
 
 u32 predict_cpu_utilization(prediction_model_t *model)
 {
+    model->predictions_made++;
     if (model->history_count < 5)
-        return 50;  // Default prediction if not enough history
+        return note_prediction(model, 50);  // Default prediction if not enough history
 
     cpu_metrics_t *current = &model->history[(model->history_index - 1 + HISTORY_SIZE) % HISTORY_SIZE];
     cpu_metrics_t *prev1 = &model->history[(model->history_index - 2 + HISTORY_SIZE) % HISTORY_SIZE];
@@ -43,13 +117,76 @@ u32 predict_cpu_utilization(prediction_model_t *model)
                      (acceleration + prev_acceleration) / 4;
 
     prediction = apply_pattern_adjustment(model, prediction);
+    prediction += model->cross_policy_term;
+    prediction += model->migration_term;
 
     if (prediction < 0)
         prediction = 0;
     if (prediction > 100)
         prediction = 100;
 
-    return (u32)prediction;
+    return note_prediction(model, (u32)prediction);
+}
+
+u32 predict_ewma_utilization(prediction_model_t *model)
+{
+    u32 count = min_t(u32, model->history_count, 8);
+    u32 sum = 0, weight_sum = 0;
+
+    model->predictions_made++;
+    if (count == 0)
+        return note_prediction(model, 50);
+
+    // Newest sample weighs 128, each older one half as much
+    for (u32 i = 0; i < count; i++) {
+        u32 weight = 128 >> i;
+        sum += model->history[(model->history_index - 1 - i + HISTORY_SIZE) % HISTORY_SIZE].cpu_util * weight;
+        weight_sum += weight;
+    }
+    return note_prediction(model, min_t(u32, sum / weight_sum, 100));
+}
+
+u32 predict_with_engine(prediction_model_t *model, u32 engine)
+{
+    switch (engine) {
+    case PREDICTION_ENGINE_EWMA:
+        return predict_ewma_utilization(model);
+    case PREDICTION_ENGINE_TREND:
+    default:
+        return predict_cpu_utilization(model);
+    }
+}
+
+/*
+ * Utilization at the given quantile of the prediction's error distribution,
+ * e.g. quantile 95 is a level the load stayed below 95% of the time after
+ * similar predictions. Without enough residuals the point prediction is
+ * returned.
+ */
+u32 predict_utilization_quantile(prediction_model_t *model, u32 prediction, u32 quantile)
+{
+    u32 threshold, cumulative = 0;
+    int bucket = RESIDUAL_BUCKETS - 1;
+
+    if (model->residual_weight < RESIDUAL_MIN_WEIGHT)
+        return prediction;
+
+    threshold = model->residual_weight * min_t(u32, quantile, 100) / 100;
+    for (int i = 0; i < RESIDUAL_BUCKETS; i++) {
+        cumulative += model->residual_hist[i];
+        if (cumulative >= threshold && cumulative > 0) {
+            bucket = i;
+            break;
+        }
+    }
+    return (u32)clamp((int)prediction + bucket * 5 - 100, 0, 100);
+}
+
+// 90% prediction interval (p5 to p95)
+void prediction_interval(prediction_model_t *model, u32 prediction, u32 *low, u32 *high)
+{
+    *low = predict_utilization_quantile(model, prediction, 5);
+    *high = predict_utilization_quantile(model, prediction, 95);
 }
 
 int apply_pattern_adjustment(prediction_model_t *model, int base_prediction)
@@ -67,7 +204,7 @@ int apply_pattern_adjustment(prediction_model_t *model, int base_prediction)
     for (int i = 0; i < model->pattern_count; i++) {
         if (pattern_signature_match(model->patterns[i].metrics_signature, signature)) {
             int pattern_weight = model->patterns[i].frequency;
-            int adjustment = model->patterns[i].target_freq - base_prediction;
+            int adjustment = (int)model->patterns[i].avg_cpu_util - base_prediction;
             return base_prediction + (adjustment * pattern_weight) / 100;
         }
     }
@@ -107,3 +244,183 @@ bool pattern_signature_match(const u8 *sig1, const u8 *sig2)
     }
     return distance < 8;
 }
+
+void save_model_state(const prediction_model_t *model, prediction_model_state_t *state)
+{
+    u32 count = min_t(u32, model->history_count, SAVED_HISTORY_SIZE);
+
+    memset(state, 0, sizeof(*state));
+    state->version = MODEL_STATE_VERSION;
+    state->size = sizeof(*state);
+    state->prediction_window = model->prediction_window;
+    state->aggressiveness = model->aggressiveness;
+    state->learning_rate = model->learning_rate;
+    state->min_perf_gain = model->min_perf_gain;
+    state->llc_miss_penalty = model->llc_miss_penalty;
+    memcpy(state->patterns, model->patterns, sizeof(state->patterns));
+    state->pattern_count = model->pattern_count;
+    state->freq_sensitivity = model->freq_sensitivity;
+    memcpy(state->residual_hist, model->residual_hist, sizeof(state->residual_hist));
+    state->residual_weight = model->residual_weight;
+    for (u32 i = 0; i < count; i++)
+        state->history[i] = model->history[(model->history_index - count + i + HISTORY_SIZE) % HISTORY_SIZE];
+    state->history_count = count;
+    state->predictions_made = model->predictions_made;
+    state->prediction_errors = model->prediction_errors;
+    state->avg_prediction_error = model->avg_prediction_error;
+}
+
+// Saved states can come from user space, so check everything used as an index
+bool model_state_valid(const prediction_model_state_t *state)
+{
+    u32 residual_weight = 0;
+
+    for (int i = 0; i < RESIDUAL_BUCKETS; i++)
+        residual_weight += state->residual_hist[i];
+    if (residual_weight != state->residual_weight)
+        return false;
+
+    return state->version == MODEL_STATE_VERSION &&
+           state->size == sizeof(*state) &&
+           state->pattern_count <= MAX_PATTERNS &&
+           state->history_count <= SAVED_HISTORY_SIZE &&
+           state->aggressiveness <= 100 &&
+           state->learning_rate <= 100 &&
+           state->freq_sensitivity <= 100;
+}
+
+// Replaces the learned state; target_quantile is configuration and survives
+int restore_model_state(prediction_model_t *model, const prediction_model_state_t *state)
+{
+    u32 target_quantile = model->target_quantile;
+
+    if (!model_state_valid(state))
+        return -EINVAL;
+
+    init_prediction_model(model);
+    model->target_quantile = target_quantile;
+    model->prediction_window = state->prediction_window;
+    model->aggressiveness = state->aggressiveness;
+    model->learning_rate = state->learning_rate;
+    model->min_perf_gain = state->min_perf_gain;
+    model->llc_miss_penalty = state->llc_miss_penalty;
+    memcpy(model->patterns, state->patterns, sizeof(model->patterns));
+    model->pattern_count = state->pattern_count;
+    model->freq_sensitivity = state->freq_sensitivity;
+    memcpy(model->residual_hist, state->residual_hist, sizeof(model->residual_hist));
+    model->residual_weight = state->residual_weight;
+    for (u32 i = 0; i < state->history_count; i++)
+        model->history[i] = state->history[i];
+    model->history_index = state->history_count % HISTORY_SIZE;
+    model->history_count = state->history_count;
+    model->predictions_made = state->predictions_made;
+    model->prediction_errors = state->prediction_errors;
+    model->avg_prediction_error = state->avg_prediction_error;
+    return 0;
+}
+
+/*
+ * Cap an increase from cur_freq to target_freq at the lowest frequency that
+ * still delivers all but min_perf_gain percent of target_freq's performance.
+ * Run time per unit of work is modelled as s * cur / f + (1 - s), relative to
+ * the time at cur_freq, where s is the frequency sensitivity. Without valid
+ * counters the target is returned unchanged.
+ */
+u32 frequency_sensitivity_cap(prediction_model_t *model, u32 cur_freq, u32 target_freq)
+{
+    u64 s = model->freq_sensitivity;
+    u64 mem_time = (100 - s) * 100;
+    u64 target_time, allowed_time, cap;
+
+    if (!model->counters_valid || s >= 100 || !cur_freq || target_freq <= cur_freq)
+        return target_freq;
+
+    target_time = div_u64(s * 100 * cur_freq, target_freq) + mem_time;
+    allowed_time = div_u64(target_time * (100 + model->min_perf_gain), 100);
+    if (allowed_time <= mem_time)
+        return cur_freq;
+
+    cap = div64_u64(s * 100 * cur_freq, allowed_time - mem_time);
+    return (u32)clamp_t(u64, cap, cur_freq, target_freq);
+}
+
+/*
+ * Runs of consecutive history samples whose utilization lies in [low, high],
+ * newest first. Reports the mean length of the completed runs and the mean
+ * idle time they add up to, and the length of the run in progress (0 if the
+ * newest sample is outside the range). Returns the number of completed runs;
+ * the oldest one may have started before the history did and counts anyway.
+ */
+static u32 history_runs(prediction_model_t *model, u32 low, u32 high,
+                        u32 *mean_len, u64 *mean_idle_ns, u32 *current_len)
+{
+    u32 run = 0, runs = 0, total = 0;
+    u64 run_idle = 0, total_idle = 0;
+    bool in_current = true;
+
+    *current_len = 0;
+    for (u32 i = 1; i <= model->history_count; i++) {
+        cpu_metrics_t *m = &model->history[(model->history_index - i + HISTORY_SIZE) % HISTORY_SIZE];
+
+        if (m->cpu_util >= low && m->cpu_util <= high) {
+            run++;
+            run_idle += m->idle_time;
+            continue;
+        }
+        if (in_current) {
+            *current_len = run;
+        } else if (run) {
+            runs++;
+            total += run;
+            total_idle += run_idle;
+        }
+        in_current = false;
+        run = 0;
+        run_idle = 0;
+    }
+    if (in_current) {
+        *current_len = run;
+    } else if (run) {
+        runs++;
+        total += run;
+        total_idle += run_idle;
+    }
+
+    *mean_len = runs ? total / runs : 0;
+    *mean_idle_ns = runs ? div_u64(total_idle, runs) : 0;
+    return runs;
+}
+
+/*
+ * Samples the current (or next) burst is expected to keep running for: the
+ * mean length of the completed bursts in the history, less the part of the
+ * current burst already run. A burst that has outlived the mean is expected
+ * to last about as long again.
+ */
+u32 predict_burst_samples(prediction_model_t *model)
+{
+    u32 mean, current;
+    u64 idle_ns;
+
+    if (!history_runs(model, BURST_UTIL_THRESHOLD, 100, &mean, &idle_ns, &current))
+        return max(current, 1u);
+    return mean > current ? mean - current : max(current, 1u);
+}
+
+/*
+ * Length of the idle window expected after the current burst, from the idle
+ * time recorded over the near-idle stretches in the history. 0 when the
+ * history shows no idle stretches, i.e. the load is continuous. While idle,
+ * the remainder of the current window, 0 once it has outlived the mean.
+ */
+u64 predict_idle_window_ns(prediction_model_t *model)
+{
+    u32 mean, current;
+    u64 idle_ns;
+
+    if (!history_runs(model, 0, IDLE_UTIL_THRESHOLD, &mean, &idle_ns, &current))
+        return 0;
+    if (current && current < mean)
+        return div_u64(idle_ns * (mean - current), mean);
+    return current ? 0 : idle_ns;
+}
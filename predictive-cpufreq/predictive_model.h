@@ -6,16 +6,38 @@
 #define PREDICTION_WINDOW_MS 100   // Prediction window size
 #define HISTORY_SIZE 100           // Number of historical data points to keep
 #define MAX_PATTERNS 20            // Maximum number of workload patterns to track
+#define SAVED_HISTORY_SIZE 8       // History samples kept in a saved model state
+#define MODEL_STATE_VERSION 2      // Bump when prediction_model_state_t changes
+#define RESIDUAL_BUCKETS 41        // Residual histogram: 5% buckets from -100 to +100
+#define RESIDUAL_WEIGHT 16         // Histogram weight added per residual
+#define RESIDUAL_MAX_WEIGHT 4096   // Halve the histogram above this (~256 samples)
+#define RESIDUAL_MIN_WEIGHT (20 * RESIDUAL_WEIGHT)  // Residuals needed before quantiles are used
+#define BURST_UTIL_THRESHOLD 60    // Samples at or above this utilization belong to a burst
+#define IDLE_UTIL_THRESHOLD 10     // Samples at or below this utilization belong to an idle window
+
+// Prediction algorithms a model can run
+enum prediction_engine {
+    PREDICTION_ENGINE_TREND,       // Trend/acceleration extrapolation with pattern adjustment
+    PREDICTION_ENGINE_EWMA,        // Exponentially weighted average of recent samples
+    PREDICTION_ENGINE_MAX,
+};
 
 typedef struct {
     u64 timestamp;                 // Timestamp in nanoseconds
     u32 cpu_util;                  // CPU utilization percentage (0-100)
     u32 freq;                      // Current CPU frequency in KHz
-    u32 irq_count;                 // Number of interrupts since last sample
+    u32 irq_count;                 // Interrupts serviced, cumulative (consumers use differences)
     u32 process_switches;          // Number of context switches
-    u64 idle_time;                 // Total idle time since last sample
+    u64 idle_time;                 // Idle time since last sample (ns)
     u32 iowait;                    // I/O wait percentage
     u32 runnable_tasks;            // Number of tasks in runnable state
+
+    // Hardware counter deltas since last sample, valid only if counters_valid
+    u64 instructions;              // Instructions retired
+    u64 cycles;                    // Unhalted core cycles
+    u64 llc_misses;                // Last level cache misses
+    u64 stall_cycles;              // Backend stall cycles (0 if not supported)
+    bool counters_valid;           // Counters ran for the whole sample
 } cpu_metrics_t;
 
 typedef struct {
@@ -27,6 +49,22 @@ typedef struct {
     u32 prediction_window;                // How far ahead to predict (ms)
     u32 aggressiveness;                   // How aggressively to scale (0-100)
     u32 learning_rate;                    // Model adaptation rate
+    u32 min_perf_gain;                    // Min predicted speedup (%) worth a frequency increase
+    u32 llc_miss_penalty;                 // Stall cycles per LLC miss when no stall counter exists
+
+    // Prediction uncertainty: decaying histogram of (actual - predicted)
+    u32 target_quantile;                  // Quantile of predicted utilization to provision for (0-100)
+    u16 residual_hist[RESIDUAL_BUCKETS];
+    u32 residual_weight;                  // Sum of residual_hist
+    u32 last_prediction;                  // Awaiting the next sample's residual
+    bool prediction_pending;
+
+    int cross_policy_term;                // Load change (%) announced by correlated policies
+    int migration_term;                   // Task utilization (%) migrated in (+) or out (-)
+
+    // Memory-bound phase detection
+    u32 freq_sensitivity;                 // Share of runtime that scales with frequency (0-100)
+    bool counters_valid;                  // Latest sample carried hardware counters
 
     // Pattern recognition data
     struct workload_pattern {
@@ -45,12 +83,51 @@ typedef struct {
     u32 avg_prediction_error;             // Average prediction error percentage
 } prediction_model_t;
 
+// Learned model state that outlives the governor instance, see model_store.c
+typedef struct {
+    u32 version;                          // MODEL_STATE_VERSION
+    u32 size;                             // sizeof(prediction_model_state_t)
+
+    // Tuned parameters
+    u32 prediction_window;
+    u32 aggressiveness;
+    u32 learning_rate;
+    u32 min_perf_gain;
+    u32 llc_miss_penalty;
+
+    // Learned data
+    struct workload_pattern patterns[MAX_PATTERNS];
+    u32 pattern_count;
+    u32 freq_sensitivity;
+    u16 residual_hist[RESIDUAL_BUCKETS];
+    u32 residual_weight;
+
+    // Most recent samples, oldest first, so predictions resume at once
+    cpu_metrics_t history[SAVED_HISTORY_SIZE];
+    u32 history_count;
+
+    // Model statistics
+    u32 predictions_made;
+    u32 prediction_errors;
+    u32 avg_prediction_error;
+} prediction_model_state_t;
+
 void init_prediction_model(prediction_model_t *model);
 void add_metrics_to_history(prediction_model_t *model, cpu_metrics_t *metrics);
 u32 predict_cpu_utilization(prediction_model_t *model);
+u32 predict_ewma_utilization(prediction_model_t *model);
+u32 predict_with_engine(prediction_model_t *model, u32 engine);
+u32 predict_utilization_quantile(prediction_model_t *model, u32 prediction, u32 quantile);
+void prediction_interval(prediction_model_t *model, u32 prediction, u32 *low, u32 *high);
 int apply_pattern_adjustment(prediction_model_t *model, int base_prediction);
 void generate_pattern_signature(cpu_metrics_t *current, cpu_metrics_t *prev1, cpu_metrics_t *prev2, u8 *signature);
 bool pattern_signature_match(const u8 *sig1, const u8 *sig2);
 void update_patterns(prediction_model_t *model);
+void save_model_state(const prediction_model_t *model, prediction_model_state_t *state);
+bool model_state_valid(const prediction_model_state_t *state);
+int restore_model_state(prediction_model_t *model, const prediction_model_state_t *state);
+u32 frequency_sensitivity_cap(prediction_model_t *model, u32 cur_freq, u32 target_freq);
+u32 predict_burst_samples(prediction_model_t *model);
+u64 predict_idle_window_ns(prediction_model_t *model);
 
 #endif // PREDICTIVE_MODEL_H
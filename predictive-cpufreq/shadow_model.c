@@ -0,0 +1,162 @@
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include "predictive_model.h"
+#include "predictive_governor.h"
+#include "pattern_recognizer.h"
+#include "shadow_model.h"
+
+/*
+ * Shadow models see the same samples as the primary model and choose a
+ * frequency each time, but only the primary's choice is applied. Each
+ * model is scored against the utilization that actually followed, so a new
+ * engine or parameter set can be compared on production load before it is
+ * switched on. Shadows are configured when the governor starts on a policy.
+ */
+static unsigned int shadow_count;
+module_param(shadow_count, uint, 0644);
+MODULE_PARM_DESC(shadow_count, "Shadow models per policy (0-" __stringify(MAX_SHADOW_MODELS) ")");
+
+static unsigned int shadow_engine[MAX_SHADOW_MODELS] = { PREDICTION_ENGINE_EWMA, PREDICTION_ENGINE_TREND };
+module_param_array(shadow_engine, uint, NULL, 0644);
+MODULE_PARM_DESC(shadow_engine, "Prediction engine of each shadow model (0=trend, 1=ewma)");
+
+static unsigned int shadow_aggressiveness[MAX_SHADOW_MODELS] = { 50, 70 };
+module_param_array(shadow_aggressiveness, uint, NULL, 0644);
+MODULE_PARM_DESC(shadow_aggressiveness, "Aggressiveness of each shadow model (0-100)");
+
+static unsigned int shadow_quantile[MAX_SHADOW_MODELS] = { 50, 95 };
+module_param_array(shadow_quantile, uint, NULL, 0644);
+MODULE_PARM_DESC(shadow_quantile, "Target utilization quantile of each shadow model (0-100)");
+
+static const char * const prediction_engine_names[PREDICTION_ENGINE_MAX] = {
+    [PREDICTION_ENGINE_TREND] = "trend",
+    [PREDICTION_ENGINE_EWMA] = "ewma",
+};
+
+const char *prediction_engine_name(u32 engine)
+{
+    return engine < PREDICTION_ENGINE_MAX ? prediction_engine_names[engine] : "unknown";
+}
+
+// Score the pending prediction against the sample that just arrived
+void score_prediction(shadow_score_t *score, const cpu_metrics_t *actual, u32 max_freq)
+{
+    u32 error, relative_freq, demand;
+
+    if (!score->pending || !max_freq)
+        return;
+
+    error = abs((int)score->last_prediction - (int)actual->cpu_util);
+    score->samples++;
+    score->total_error += error;
+    if (error > SHADOW_LARGE_ERROR)
+        score->large_errors++;
+
+    // Dynamic power grows roughly with f^3 once voltage scales with frequency
+    relative_freq = min_t(u32, div_u64((u64)score->last_target * 1000, max_freq), 1000);
+    score->energy += relative_freq * relative_freq / 1000 * relative_freq / 1000;
+
+    // Work done at the real frequency that the chosen OPP could not have carried
+    demand = actual->cpu_util * actual->freq / 100;
+    if (demand > score->last_target)
+        score->underprovisioned++;
+    score->pending = false;
+}
+
+void record_prediction(shadow_score_t *score, u32 prediction, u32 target_freq)
+{
+    score->last_prediction = prediction;
+    score->last_target = target_freq;
+    score->pending = true;
+}
+
+// Allocate the configured shadow models; NULL with *count == 0 if none
+shadow_model_t *create_shadow_models(u32 *count)
+{
+    shadow_model_t *shadows;
+
+    *count = min_t(u32, shadow_count, MAX_SHADOW_MODELS);
+    if (!*count)
+        return NULL;
+
+    shadows = kcalloc(*count, sizeof(*shadows), GFP_KERNEL);
+    if (!shadows) {
+        *count = 0;
+        return NULL;
+    }
+
+    for (u32 i = 0; i < *count; i++) {
+        init_prediction_model(&shadows[i].model);
+        shadows[i].model.aggressiveness = min_t(u32, shadow_aggressiveness[i], 100);
+        shadows[i].model.target_quantile = min_t(u32, shadow_quantile[i], 100);
+        shadows[i].engine = shadow_engine[i] < PREDICTION_ENGINE_MAX ?
+                            shadow_engine[i] : PREDICTION_ENGINE_TREND;
+    }
+    return shadows;
+}
+
+void sample_shadow_models(shadow_model_t *shadows, u32 count, struct cpufreq_policy *policy,
+                          cpu_metrics_t *metrics)
+{
+    for (u32 i = 0; i < count; i++) {
+        shadow_model_t *shadow = &shadows[i];
+        u32 predicted_util, target_freq;
+
+        score_prediction(&shadow->score, metrics, policy->cpuinfo.max_freq);
+        add_metrics_to_history(&shadow->model, metrics);
+        predicted_util = predict_with_engine(&shadow->model, shadow->engine);
+        target_freq = calculate_target_frequency(policy, predicted_util, &shadow->model);
+        record_prediction(&shadow->score, predicted_util, target_freq);
+        if (shadow->model.predictions_made % 100 == 0)
+            update_patterns(&shadow->model);
+    }
+}
+
+static void show_score(struct seq_file *m, const char *name, u32 engine,
+                       const prediction_model_t *model, const shadow_score_t *score)
+{
+    u32 samples = max_t(u32, score->samples, 1);
+
+    seq_printf(m, "%-8s %-6s %14u %8u %8u %9llu %12u %16u %9llu\n", name,
+               prediction_engine_name(engine), model->aggressiveness,
+               model->target_quantile, score->samples,
+               div_u64(score->total_error, samples), score->large_errors,
+               score->underprovisioned, div_u64(score->energy, samples));
+}
+
+// avg_power is the mean relative power of the chosen OPPs, per-mille of max
+static int shadow_stats_show(struct seq_file *m, void *v)
+{
+    predictive_cpu_data_t *cpu_data = m->private;
+    unsigned long flags;
+    char name[16];
+
+    spin_lock_irqsave(&cpu_data->lock, flags);
+    seq_printf(m, "%-8s %-6s %14s %8s %8s %9s %12s %16s %9s\n", "model", "engine",
+               "aggressiveness", "quantile", "samples", "avg_error", "large_errors",
+               "underprovisioned", "avg_power");
+    show_score(m, "primary", PREDICTION_ENGINE_TREND, &cpu_data->model, &cpu_data->score);
+    for (u32 i = 0; i < cpu_data->shadow_count; i++) {
+        snprintf(name, sizeof(name), "shadow%u", i);
+        show_score(m, name, cpu_data->shadows[i].engine, &cpu_data->shadows[i].model,
+                   &cpu_data->shadows[i].score);
+    }
+    spin_unlock_irqrestore(&cpu_data->lock, flags);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(shadow_stats);
+
+// Expose the comparison as predictive_cpufreq/policyN/shadow_stats
+struct dentry *create_shadow_stats_file(predictive_cpu_data_t *cpu_data)
+{
+    struct dentry *dir = model_store_debugfs_dir(cpu_data->store);
+
+    if (!dir)
+        return NULL;
+    return debugfs_create_file("shadow_stats", 0444, dir, cpu_data, &shadow_stats_fops);
+}
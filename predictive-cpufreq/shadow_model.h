@@ -0,0 +1,36 @@
+#ifndef SHADOW_MODEL_H
+#define SHADOW_MODEL_H
+
+#include <linux/cpufreq.h>
+#include "predictive_model.h"
+
+#define MAX_SHADOW_MODELS 2        // Shadow models per policy
+#define SHADOW_LARGE_ERROR 20      // Prediction error (%) counted as a miss
+
+// How a model's decisions would have played out against the real load
+typedef struct {
+    u32 samples;                   // Predictions scored
+    u64 total_error;               // Sum of absolute prediction errors (%)
+    u32 large_errors;              // Predictions off by more than SHADOW_LARGE_ERROR
+    u32 underprovisioned;          // Samples where the chosen OPP was below demand
+    u64 energy;                    // Sum of relative OPP power, per-mille of max
+    u32 last_prediction;           // Prediction awaiting the next sample
+    u32 last_target;               // Frequency chosen for it (KHz)
+    bool pending;                  // last_prediction/last_target are set
+} shadow_score_t;
+
+// A model that predicts and picks frequencies but never touches the hardware
+typedef struct {
+    prediction_model_t model;
+    u32 engine;                    // enum prediction_engine
+    shadow_score_t score;
+} shadow_model_t;
+
+void score_prediction(shadow_score_t *score, const cpu_metrics_t *actual, u32 max_freq);
+void record_prediction(shadow_score_t *score, u32 prediction, u32 target_freq);
+shadow_model_t *create_shadow_models(u32 *count);
+void sample_shadow_models(shadow_model_t *shadows, u32 count, struct cpufreq_policy *policy,
+                          cpu_metrics_t *metrics);
+const char *prediction_engine_name(u32 engine);
+
+#endif // SHADOW_MODEL_H
@@ -0,0 +1,98 @@
+#include <linux/kernel.h>
+#include <linux/cpufreq.h>
+#include "predictive_model.h"
+#include "predictive_governor.h"
+#include "energy_decision.h"
+#include "target_frequency.h"
+
+/*
+ * Frequency selection from a predicted utilization. Kept apart from the
+ * governor glue and resolved against policy->freq_table here rather than
+ * through the cpufreq core, so it can be tested with a fake policy on
+ * kernels without CONFIG_CPU_FREQ (UML).
+ */
+
+/*
+ * Table entry for target_freq within the policy limits: the lowest at or
+ * above it for CPUFREQ_RELATION_L, the highest at or below it otherwise.
+ * Without a table the clamped target is returned.
+ */
+u32 resolve_frequency(struct cpufreq_policy *policy, u32 target_freq, unsigned int relation)
+{
+    struct cpufreq_frequency_table *pos;
+    u32 min_freq = policy->min ? policy->min : policy->cpuinfo.min_freq;
+    u32 max_freq = policy->max ? policy->max : policy->cpuinfo.max_freq;
+    u32 best = 0, fallback = 0;
+
+    target_freq = clamp(target_freq, min_freq, max_freq);
+    if (!policy->freq_table)
+        return target_freq;
+
+    cpufreq_for_each_valid_entry(pos, policy->freq_table) {
+        u32 freq = pos->frequency;
+
+        if (freq < min_freq || freq > max_freq)
+            continue;
+        if (relation == CPUFREQ_RELATION_L) {
+            if (freq >= target_freq && (!best || freq < best))
+                best = freq;
+            if (freq > fallback)
+                fallback = freq;
+        } else {
+            if (freq <= target_freq && freq > best)
+                best = freq;
+            if (!fallback || freq < fallback)
+                fallback = freq;
+        }
+    }
+    if (best)
+        return best;
+    return fallback ? fallback : target_freq;
+}
+
+u32 calculate_target_frequency(struct cpufreq_policy *policy, u32 predicted_util, prediction_model_t *model)
+{
+    predictive_cpu_data_t *cpu_data = policy->governor_data;
+    u32 min_freq = policy->cpuinfo.min_freq;
+    u32 max_freq = policy->cpuinfo.max_freq;
+    u32 range = max_freq - min_freq;
+    u32 adjusted_util = predicted_util;
+    // Provision for a quantile of the load once the residuals show how far off predictions run
+    if (model->residual_weight >= RESIDUAL_MIN_WEIGHT) {
+        adjusted_util = predict_utilization_quantile(model, predicted_util, model->target_quantile);
+    } else if (model->aggressiveness > 50) {
+        adjusted_util = predicted_util + ((model->aggressiveness - 50) * predicted_util) / 100;
+    } else if (model->aggressiveness < 50) {
+        adjusted_util = predicted_util * model->aggressiveness / 50;
+    }
+    if (adjusted_util > 100)
+        adjusted_util = 100;
+    u32 target_freq = 0;
+    bool race;
+    if (cpu_data && energy_decision_enabled())
+        target_freq = energy_decision_target(&cpu_data->energy, model, policy->cur, adjusted_util,
+                                             cpu_data->energy.sample_ms, &race);
+    if (target_freq) {
+        // Shadow models share the policy; count the applied model's decisions only
+        if (model == &cpu_data->model) {
+            if (race)
+                cpu_data->energy.races++;
+            else
+                cpu_data->energy.paces++;
+        }
+    } else {
+        target_freq = min_freq + (range * adjusted_util) / 100;
+    }
+    // Don't pay for frequency a memory-bound phase can't use
+    target_freq = frequency_sensitivity_cap(model, policy->cur, target_freq);
+    return resolve_frequency(policy, target_freq, CPUFREQ_RELATION_L);
+}
+
+// Proportional frequency for a utilization floor applied outside the model
+u32 util_floor_frequency(struct cpufreq_policy *policy, u32 util)
+{
+    u32 min_freq = policy->cpuinfo.min_freq;
+    u32 range = policy->cpuinfo.max_freq - min_freq;
+
+    return resolve_frequency(policy, min_freq + range * min_t(u32, util, 100) / 100, CPUFREQ_RELATION_L);
+}
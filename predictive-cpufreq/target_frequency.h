@@ -0,0 +1,11 @@
+#ifndef TARGET_FREQUENCY_H
+#define TARGET_FREQUENCY_H
+
+#include <linux/cpufreq.h>
+#include "predictive_model.h"
+
+u32 resolve_frequency(struct cpufreq_policy *policy, u32 target_freq, unsigned int relation);
+u32 calculate_target_frequency(struct cpufreq_policy *policy, u32 predicted_util, prediction_model_t *model);
+u32 util_floor_frequency(struct cpufreq_policy *policy, u32 util);
+
+#endif // TARGET_FREQUENCY_H
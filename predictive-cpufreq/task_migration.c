@@ -0,0 +1,166 @@
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/sched.h>
+#include <linux/cpufreq.h>
+#include <linux/cpumask.h>
+#include <linux/percpu.h>
+#include <linux/atomic.h>
+#include <linux/math64.h>
+#include <linux/timekeeping.h>
+#include <linux/irq_work.h>
+#include <linux/tracepoint.h>
+#include "task_migration.h"
+
+/*
+ * Utilization moved between CPUs by the scheduler. The model learns load from
+ * the policy's measured CPU, so after a heavy task migrates onto it the model
+ * keeps predicting the old, low load for several samples, and after one
+ * leaves it keeps predicting the task it lost. A probe on sched_migrate_task,
+ * which also covers wake-up placement, reads the task's PELT utilization and
+ * books it against the measured CPUs it moves between.
+ *
+ * The next sample already measures the move for the part of its window after
+ * it, so the sample's term is only the remainder: each move is weighted by the
+ * time since the window opened. A move onto the measured CPU also kicks the
+ * policy to re-evaluate its target at once, at most MIGRATION_KICK_DIVISOR
+ * times per sample period, with the full utilization the history has not yet
+ * seen. The sample discards what the kicks used, so neither path counts a
+ * move twice.
+ *
+ * The probe runs under the scheduler's runqueue locks, so it only touches
+ * per-CPU atomics and queues an irq_work; the policy's irq_work handler
+ * queues its re-evaluation.
+ */
+
+struct migration_cpu {
+    atomic_t moved;                          // Net utilization (%) moved here this window, for kicks
+    atomic64_t moved_ns;                     // Same, times how far into the window each move came
+    u64 window_start;                        // When the current sample window opened
+    struct irq_work *kick;                   // Owning policy's kick, NULL unless the measured CPU
+};
+
+static unsigned int migration_boost_util = 20;
+module_param(migration_boost_util, uint, 0644);
+MODULE_PARM_DESC(migration_boost_util, "Smallest task utilization (% of a CPU) whose migration adjusts the prediction, 0 to disable");
+
+static DEFINE_PER_CPU(struct migration_cpu, migration_cpus);
+static struct tracepoint *migrate_tp;
+
+#ifdef CONFIG_SMP
+// Races with a sample closing the window only shift a move into the next one
+static void book_move(struct migration_cpu *mc, int util, u64 now)
+{
+    s64 into = now - READ_ONCE(mc->window_start);
+
+    atomic_add(util, &mc->moved);
+    atomic64_add((s64)util * max_t(s64, into, 0), &mc->moved_ns);
+}
+
+static void probe_migrate_task(void *data, struct task_struct *p, int dest_cpu)
+{
+    unsigned int threshold = READ_ONCE(migration_boost_util);
+    struct migration_cpu *src, *dst;
+    struct irq_work *kick;
+    u64 now;
+    int util;
+
+    if (!threshold)
+        return;
+    util = (READ_ONCE(p->se.avg.util_avg) * 100) >> SCHED_CAPACITY_SHIFT;
+    if (util < threshold)
+        return;
+
+    now = ktime_get_mono_fast_ns();
+    src = per_cpu_ptr(&migration_cpus, task_cpu(p));
+    dst = per_cpu_ptr(&migration_cpus, dest_cpu);
+    if (READ_ONCE(src->kick))
+        book_move(src, -util, now);
+    kick = READ_ONCE(dst->kick);
+    if (kick) {
+        book_move(dst, util, now);
+        irq_work_queue(kick);
+    }
+}
+
+static void find_migrate_tp(struct tracepoint *tp, void *priv)
+{
+    if (!strcmp(tp->name, "sched_migrate_task"))
+        migrate_tp = tp;
+}
+
+int task_migration_init(void)
+{
+    int ret;
+
+    for_each_kernel_tracepoint(find_migrate_tp, NULL);
+    if (!migrate_tp) {
+        pr_info("predictive-cpufreq: sched_migrate_task tracepoint not found, no migration boost\n");
+        return 0;
+    }
+    ret = tracepoint_probe_register(migrate_tp, probe_migrate_task, NULL);
+    if (ret)
+        migrate_tp = NULL;
+    return ret;
+}
+
+void task_migration_exit(void)
+{
+    if (!migrate_tp)
+        return;
+    tracepoint_probe_unregister(migrate_tp, probe_migrate_task, NULL);
+    tracepoint_synchronize_unregister();
+    migrate_tp = NULL;
+}
+#else
+int task_migration_init(void)
+{
+    return 0;
+}
+
+void task_migration_exit(void)
+{
+}
+#endif
+
+void task_migration_register(struct cpufreq_policy *policy, struct irq_work *kick)
+{
+    struct migration_cpu *mc = per_cpu_ptr(&migration_cpus, policy->cpu);
+
+    atomic_set(&mc->moved, 0);
+    atomic64_set(&mc->moved_ns, 0);
+    WRITE_ONCE(mc->window_start, ktime_get_mono_fast_ns());
+    WRITE_ONCE(mc->kick, kick);
+}
+
+// Returns with no probe still using kick and the kick itself finished
+void task_migration_unregister(struct cpufreq_policy *policy, struct irq_work *kick)
+{
+    int cpu;
+
+    for_each_cpu(cpu, policy->related_cpus)
+        WRITE_ONCE(per_cpu_ptr(&migration_cpus, cpu)->kick, NULL);
+    if (migrate_tp)
+        tracepoint_synchronize_unregister();
+    irq_work_sync(kick);
+}
+
+// Net utilization (%) moved onto the measured CPU since the last sample
+int task_migration_kick_term(struct cpufreq_policy *policy)
+{
+    int term = atomic_read(&per_cpu_ptr(&migration_cpus, policy->cpu)->moved);
+
+    return clamp(term, -MIGRATION_MAX_TERM, MIGRATION_MAX_TERM);
+}
+
+// Closes the sample window: the part of its moves the sample did not measure
+int task_migration_sample_term(struct cpufreq_policy *policy)
+{
+    struct migration_cpu *mc = per_cpu_ptr(&migration_cpus, policy->cpu);
+    u64 now = ktime_get_mono_fast_ns();
+    u64 start = READ_ONCE(mc->window_start);
+
+    WRITE_ONCE(mc->window_start, now);
+    atomic_set(&mc->moved, 0);
+    return migration_window_term(atomic64_xchg(&mc->moved_ns, 0), now - start);
+}
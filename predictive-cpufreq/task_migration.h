@@ -0,0 +1,33 @@
+#ifndef TASK_MIGRATION_H
+#define TASK_MIGRATION_H
+
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+
+#define MIGRATION_MAX_TERM 100     // Bound on the migration term (%)
+#define MIGRATION_KICK_DIVISOR 4   // At most one kick per this fraction of a sample period
+
+struct cpufreq_policy;
+struct irq_work;
+
+int task_migration_init(void);
+void task_migration_exit(void);
+void task_migration_register(struct cpufreq_policy *policy, struct irq_work *kick);
+void task_migration_unregister(struct cpufreq_policy *policy, struct irq_work *kick);
+int task_migration_kick_term(struct cpufreq_policy *policy);
+int task_migration_sample_term(struct cpufreq_policy *policy);
+
+/*
+ * Utilization (%) a sample window of window_ns missed: util_ns sums each
+ * move's utilization times how far into the window it came, signed as for
+ * the term. A move at the window's start was measured in full and adds 0.
+ */
+static inline int migration_window_term(s64 util_ns, u64 window_ns)
+{
+    if (!window_ns)
+        return 0;
+    return clamp_t(s64, div64_s64(util_ns, window_ns), -MIGRATION_MAX_TERM, MIGRATION_MAX_TERM);
+}
+
+#endif // TASK_MIGRATION_H
@@ -0,0 +1,584 @@
+/*
+ * KUnit tests for the predictive governor: prediction model, pattern
+ * recognizer, target frequency selection, thermal, energy and iowait boost
+ * decisions and the metric collector's delta math, plus timed cases for the
+ * per-sample hot path. Needs no cpufreq driver or hardware:
+ *
+ *   ./tools/testing/kunit/kunit.py run --kunitconfig=drivers/cpufreq/predictive
+ */
+#include <kunit/test.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/cpufreq.h>
+#include <linux/timekeeping.h>
+#include <linux/math64.h>
+#include "../predictive_model.h"
+#include "../pattern_recognizer.h"
+#include "../metric_collector.h"
+#include "../target_frequency.h"
+#include "../thermal_budget.h"
+#include "../energy_decision.h"
+#include "../iowait_boost.h"
+#include "../task_migration.h"
+
+#define BENCH_ITERATIONS 10000
+
+// Generous defaults so slow CI hosts and UML pass; tighten per machine
+static unsigned int bench_sample_ns = 20000;
+module_param(bench_sample_ns, uint, 0644);
+MODULE_PARM_DESC(bench_sample_ns, "Fail threshold for one sample through the hot path (ns)");
+
+static unsigned int bench_update_patterns_ns = 1000000;
+module_param(bench_update_patterns_ns, uint, 0644);
+MODULE_PARM_DESC(bench_update_patterns_ns, "Fail threshold for one update_patterns() call (ns)");
+
+static struct cpufreq_frequency_table test_freq_table[] = {
+    { .frequency = 1600000 }, { .frequency = 800000 }, { .frequency = 3200000 },
+    { .frequency = CPUFREQ_ENTRY_INVALID }, { .frequency = 2400000 },
+    { .frequency = CPUFREQ_TABLE_END },
+};
+
+static prediction_model_t *alloc_model(struct kunit *test)
+{
+    prediction_model_t *model = kunit_kzalloc(test, sizeof(*model), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, model);
+    init_prediction_model(model);
+    return model;
+}
+
+static struct cpufreq_policy *alloc_policy(struct kunit *test, bool table)
+{
+    struct cpufreq_policy *policy = kunit_kzalloc(test, sizeof(*policy), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, policy);
+    policy->cpuinfo.min_freq = 800000;
+    policy->cpuinfo.max_freq = 3200000;
+    policy->min = 800000;
+    policy->max = 3200000;
+    policy->cur = 1600000;
+    policy->freq_table = table ? test_freq_table : NULL;
+    return policy;
+}
+
+static void feed(prediction_model_t *model, u32 util, u32 irqs)
+{
+    cpu_metrics_t metrics = { 0 };
+
+    metrics.cpu_util = util;
+    metrics.freq = 1000000 + util * 15000;
+    metrics.irq_count = irqs;
+    metrics.idle_time = (100 - util) * 500000ULL;
+    metrics.iowait = util / 10;
+    metrics.runnable_tasks = util / 20;
+    add_metrics_to_history(model, &metrics);
+}
+
+/* Prediction model */
+
+static void model_default_prediction_test(struct kunit *test)
+{
+    prediction_model_t *model = alloc_model(test);
+
+    KUNIT_EXPECT_EQ(test, predict_cpu_utilization(model), 50U);
+    KUNIT_EXPECT_EQ(test, model->predictions_made, 1U);
+}
+
+static void model_follows_ramp_test(struct kunit *test)
+{
+    prediction_model_t *model = alloc_model(test);
+
+    for (u32 i = 0; i < 40; i++)
+        feed(model, i * 2, i * 10);
+    // Next sample of the ramp is 80
+    KUNIT_EXPECT_LE(test, abs((int)predict_cpu_utilization(model) - 80), 10);
+}
+
+static void model_prediction_bounds_test(struct kunit *test)
+{
+    prediction_model_t *model = alloc_model(test);
+
+    for (u32 i = 0; i < 20; i++)
+        feed(model, i < 10 ? 100 : 0, i);
+    KUNIT_EXPECT_LE(test, predict_cpu_utilization(model), 100U);
+    KUNIT_EXPECT_LE(test, predict_ewma_utilization(model), 100U);
+    for (u32 i = 0; i < 10; i++)
+        feed(model, 100 - i * 10, i);
+    KUNIT_EXPECT_LE(test, predict_cpu_utilization(model), 100U);
+}
+
+static void model_quantiles_test(struct kunit *test)
+{
+    prediction_model_t *model = alloc_model(test);
+    u32 point, low, high;
+
+    for (u32 i = 0; i < 200; i++) {
+        feed(model, 40 + ((i * 37) % 41) - 20, i * 10);   // Noisy load around 40%
+        predict_cpu_utilization(model);
+    }
+    point = model->last_prediction;
+    prediction_interval(model, point, &low, &high);
+    KUNIT_EXPECT_LT(test, low, point);
+    KUNIT_EXPECT_GT(test, high, point);
+    KUNIT_EXPECT_LE(test, predict_utilization_quantile(model, point, 50),
+                    predict_utilization_quantile(model, point, 95));
+}
+
+static void model_state_roundtrip_test(struct kunit *test)
+{
+    prediction_model_t *model = alloc_model(test);
+    prediction_model_t *restored = alloc_model(test);
+    prediction_model_state_t *state = kunit_kzalloc(test, sizeof(*state), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, state);
+    for (u32 i = 0; i < 100; i++)
+        feed(model, (i % 20) * 5, i * 10);
+    update_patterns(model);
+    save_model_state(model, state);
+    KUNIT_EXPECT_TRUE(test, model_state_valid(state));
+    restored->target_quantile = 95;
+    KUNIT_ASSERT_EQ(test, restore_model_state(restored, state), 0);
+    KUNIT_EXPECT_EQ(test, restored->target_quantile, 95U);
+    KUNIT_EXPECT_EQ(test, restored->pattern_count, model->pattern_count);
+    KUNIT_EXPECT_EQ(test, predict_cpu_utilization(restored), predict_cpu_utilization(model));
+
+    state->pattern_count = MAX_PATTERNS + 1;
+    KUNIT_EXPECT_EQ(test, restore_model_state(restored, state), -EINVAL);
+}
+
+static void model_memory_bound_cap_test(struct kunit *test)
+{
+    prediction_model_t *model = alloc_model(test);
+
+    model->counters_valid = true;
+    model->freq_sensitivity = 100;
+    KUNIT_EXPECT_EQ(test, frequency_sensitivity_cap(model, 1500000, 3000000), 3000000U);
+
+    // Mostly memory bound: doubling the clock barely helps
+    model->freq_sensitivity = 10;
+    KUNIT_EXPECT_LT(test, frequency_sensitivity_cap(model, 1500000, 3000000), 3000000U);
+    KUNIT_EXPECT_GE(test, frequency_sensitivity_cap(model, 1500000, 3000000), 1500000U);
+
+    model->counters_valid = false;
+    KUNIT_EXPECT_EQ(test, frequency_sensitivity_cap(model, 1500000, 3000000), 3000000U);
+}
+
+static void model_burst_idle_test(struct kunit *test)
+{
+    prediction_model_t *model = alloc_model(test);
+
+    // 10-sample bursts separated by idle gaps, then 4 samples into a new burst
+    for (u32 i = 0; i < 64; i++)
+        feed(model, (i % 20) < 10 ? 95 : 5, i);
+    KUNIT_EXPECT_EQ(test, predict_burst_samples(model), 6U);
+    KUNIT_EXPECT_EQ(test, predict_idle_window_ns(model), 10 * 95 * 500000ULL);
+}
+
+static void model_migration_term_test(struct kunit *test)
+{
+    prediction_model_t *model = alloc_model(test);
+    u32 before;
+
+    for (u32 i = 0; i < 20; i++)
+        feed(model, 20, i);
+    before = predict_cpu_utilization(model);
+    // A task worth 60% of a CPU arrives before the history has seen it
+    model->migration_term = 60;
+    KUNIT_EXPECT_EQ(test, predict_cpu_utilization(model), before + 60);
+    model->migration_term = -MIGRATION_MAX_TERM;
+    KUNIT_EXPECT_EQ(test, predict_cpu_utilization(model), 0U);
+}
+
+static void model_migration_window_test(struct kunit *test)
+{
+    const u64 window = 10 * NSEC_PER_MSEC;
+    prediction_model_t *model = alloc_model(test);
+    u32 level;
+
+    /*
+     * A 60% task arrives on a CPU at 20% a quarter of the way through each
+     * window. The sample measured it for the rest, so the sample plus its
+     * term lands on the new level rather than adding the task twice.
+     */
+    for (u32 quarter = 0; quarter <= 4; quarter++) {
+        u32 measured = 20 + 60 * (4 - quarter) / 4;
+        int term = migration_window_term(60 * (s64)(window * quarter / 4), window);
+
+        KUNIT_EXPECT_EQ(test, measured + term, 80U);
+    }
+    // The same task leaving, from the source's side
+    KUNIT_EXPECT_EQ(test, 20 + 60 * 3 / 4 + migration_window_term(-60 * (s64)(window * 3 / 4), window), 20);
+    KUNIT_EXPECT_EQ(test, migration_window_term(60, 0), 0);
+
+    // A move measured in full leaves the prediction to the history alone
+    for (u32 i = 0; i < 20; i++)
+        feed(model, 80, i);
+    level = predict_cpu_utilization(model);
+    model->migration_term = migration_window_term(0, window);
+    KUNIT_EXPECT_EQ(test, predict_cpu_utilization(model), level);
+}
+
+static struct kunit_case model_test_cases[] = {
+    KUNIT_CASE(model_default_prediction_test),
+    KUNIT_CASE(model_follows_ramp_test),
+    KUNIT_CASE(model_prediction_bounds_test),
+    KUNIT_CASE(model_quantiles_test),
+    KUNIT_CASE(model_state_roundtrip_test),
+    KUNIT_CASE(model_memory_bound_cap_test),
+    KUNIT_CASE(model_burst_idle_test),
+    KUNIT_CASE(model_migration_term_test),
+    KUNIT_CASE(model_migration_window_test),
+    {}
+};
+
+static struct kunit_suite model_test_suite = {
+    .name = "predictive_cpufreq_model",
+    .test_cases = model_test_cases,
+};
+
+/* Pattern recognizer */
+
+static void pattern_signature_test(struct kunit *test)
+{
+    cpu_metrics_t a = { .cpu_util = 50, .irq_count = 100 };
+    cpu_metrics_t b = { .cpu_util = 40, .irq_count = 90 };
+    cpu_metrics_t c = { .cpu_util = 30, .irq_count = 80 };
+    cpu_metrics_t far = { .cpu_util = 100, .irq_count = 500, .iowait = 60 };
+    u8 sig1[16], sig2[16], sig3[16];
+
+    generate_pattern_signature(&a, &b, &c, sig1);
+    generate_pattern_signature(&a, &b, &c, sig2);
+    generate_pattern_signature(&far, &b, &c, sig3);
+    KUNIT_EXPECT_TRUE(test, pattern_signature_match(sig1, sig2));
+    KUNIT_EXPECT_FALSE(test, pattern_signature_match(sig1, sig3));
+}
+
+static void pattern_detection_test(struct kunit *test)
+{
+    prediction_model_t *model = alloc_model(test);
+
+    for (u32 i = 0; i < 100; i++)
+        feed(model, (i % 20) * 5, i * 10);
+    update_patterns(model);
+    KUNIT_EXPECT_GT(test, model->pattern_count, 0U);
+    KUNIT_EXPECT_LE(test, model->pattern_count, (u32)MAX_PATTERNS);
+
+    // Repeating the same load must not grow the pattern set past its bound
+    for (u32 i = 0; i < 5; i++)
+        update_patterns(model);
+    KUNIT_EXPECT_LE(test, model->pattern_count, (u32)MAX_PATTERNS);
+}
+
+static struct kunit_case pattern_test_cases[] = {
+    KUNIT_CASE(pattern_signature_test),
+    KUNIT_CASE(pattern_detection_test),
+    {}
+};
+
+static struct kunit_suite pattern_test_suite = {
+    .name = "predictive_cpufreq_patterns",
+    .test_cases = pattern_test_cases,
+};
+
+/* Target frequency selection */
+
+static void resolve_frequency_test(struct kunit *test)
+{
+    struct cpufreq_policy *policy = alloc_policy(test, true);
+
+    KUNIT_EXPECT_EQ(test, resolve_frequency(policy, 1700000, CPUFREQ_RELATION_L), 2400000U);
+    KUNIT_EXPECT_EQ(test, resolve_frequency(policy, 1700000, CPUFREQ_RELATION_H), 1600000U);
+    KUNIT_EXPECT_EQ(test, resolve_frequency(policy, 2400000, CPUFREQ_RELATION_L), 2400000U);
+    KUNIT_EXPECT_EQ(test, resolve_frequency(policy, 5000000, CPUFREQ_RELATION_L), 3200000U);
+    KUNIT_EXPECT_EQ(test, resolve_frequency(policy, 100000, CPUFREQ_RELATION_H), 800000U);
+
+    // Policy limits override the table
+    policy->max = 2400000;
+    KUNIT_EXPECT_EQ(test, resolve_frequency(policy, 3200000, CPUFREQ_RELATION_L), 2400000U);
+    policy->min = 1600000;
+    KUNIT_EXPECT_EQ(test, resolve_frequency(policy, 800000, CPUFREQ_RELATION_H), 1600000U);
+
+    policy->freq_table = NULL;
+    KUNIT_EXPECT_EQ(test, resolve_frequency(policy, 1700000, CPUFREQ_RELATION_L), 1700000U);
+}
+
+static void target_frequency_proportional_test(struct kunit *test)
+{
+    struct cpufreq_policy *policy = alloc_policy(test, true);
+    prediction_model_t *model = alloc_model(test);
+
+    KUNIT_EXPECT_EQ(test, calculate_target_frequency(policy, 0, model), 800000U);
+    KUNIT_EXPECT_EQ(test, calculate_target_frequency(policy, 100, model), 3200000U);
+    // 800000 + 2400000 * 40% = 1760000, rounded up to the next OPP
+    KUNIT_EXPECT_EQ(test, calculate_target_frequency(policy, 40, model), 2400000U);
+    KUNIT_EXPECT_EQ(test, util_floor_frequency(policy, 40), 2400000U);
+    KUNIT_EXPECT_EQ(test, util_floor_frequency(policy, 150), 3200000U);
+
+    policy->freq_table = NULL;
+    KUNIT_EXPECT_EQ(test, calculate_target_frequency(policy, 40, model), 1760000U);
+    model->aggressiveness = 100;
+    KUNIT_EXPECT_EQ(test, calculate_target_frequency(policy, 40, model), 2240000U);
+}
+
+static void target_frequency_quantile_test(struct kunit *test)
+{
+    struct cpufreq_policy *policy = alloc_policy(test, false);
+    prediction_model_t *model = alloc_model(test);
+    u32 median, tail;
+
+    for (u32 i = 0; i < 200; i++) {
+        feed(model, 40 + ((i * 37) % 41) - 20, i * 10);
+        predict_cpu_utilization(model);
+    }
+    model->target_quantile = 50;
+    median = calculate_target_frequency(policy, 40, model);
+    model->target_quantile = 95;
+    tail = calculate_target_frequency(policy, 40, model);
+    KUNIT_EXPECT_GT(test, tail, median);
+}
+
+static void thermal_budget_cap_test(struct kunit *test)
+{
+    struct cpufreq_policy *policy = alloc_policy(test, true);
+    thermal_policy_t tp = { 0 };
+    thermal_snapshot_t snapshot = { .valid = true, .temp_mc = 87000, .trip_mc = 90000 };
+
+    policy->cur = 3200000;
+    tp.heat_rate[7] = 2000;   // Trip in 1.5s at max_freq
+    tp.heat_rate[6] = 1000;
+    tp.heat_rate[5] = 500;    // Lasts exactly 6s
+    tp.learned[7] = tp.learned[6] = tp.learned[5] = true;
+    KUNIT_EXPECT_EQ(test, thermal_budget_cap(&tp, &snapshot, policy, 3200000, 6000), 2400000U);
+    KUNIT_EXPECT_EQ(test, thermal_budget_cap(&tp, &snapshot, policy, 3200000, 1000), 3200000U);
+    KUNIT_EXPECT_EQ(test, tp.capped, 1U);
+
+    // At the package power limit the frequency is held
+    snapshot.power_mw = 30000;
+    snapshot.power_limit_mw = 30000;
+    policy->cur = 1600000;
+    KUNIT_EXPECT_EQ(test, thermal_budget_cap(&tp, &snapshot, policy, 2400000, 50), 1600000U);
+}
+
+static void thermal_budget_observe_test(struct kunit *test)
+{
+    thermal_policy_t tp = { 0 };
+    thermal_snapshot_t snapshot = { .valid = true, .temp_mc = 60000, .trip_mc = 90000 };
+
+    snapshot.timestamp = 1000 * NSEC_PER_MSEC;
+    thermal_budget_observe(&tp, &snapshot, 3200000, 3200000);
+    snapshot.timestamp += 500 * NSEC_PER_MSEC;
+    snapshot.temp_mc += 1000;
+    thermal_budget_observe(&tp, &snapshot, 3200000, 3200000);
+    KUNIT_EXPECT_TRUE(test, tp.learned[THERMAL_BUCKETS - 1]);
+    KUNIT_EXPECT_EQ(test, tp.heat_rate[THERMAL_BUCKETS - 1], 2000);
+
+    // Two samples per reading, at 3.2 and 0.8 GHz: the interval ran at 2.0 GHz on average
+    thermal_budget_observe(&tp, &snapshot, 3200000, 3200000);
+    snapshot.timestamp += 100 * NSEC_PER_MSEC;
+    snapshot.temp_mc += 100;
+    thermal_budget_observe(&tp, &snapshot, 800000, 3200000);
+    KUNIT_EXPECT_TRUE(test, tp.learned[4]);
+    KUNIT_EXPECT_EQ(test, tp.heat_rate[4], 1000);
+    KUNIT_EXPECT_EQ(test, tp.heat_rate[THERMAL_BUCKETS - 1], 2000);
+}
+
+static void energy_decision_test(struct kunit *test)
+{
+    struct cpufreq_policy *policy = alloc_policy(test, true);
+    prediction_model_t *model = alloc_model(test);
+    energy_table_t *table = kunit_kzalloc(test, sizeof(*table), GFP_KERNEL);
+    bool race;
+    u32 freq, irqs = 0;
+
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, table);
+    energy_table_init(table, policy, 50);
+    KUNIT_ASSERT_EQ(test, table->count, 4U);
+    KUNIT_EXPECT_EQ(test, table->opp[0].freq, 800000U);
+    KUNIT_EXPECT_GT(test, table->opp[3].power, table->opp[0].power);
+
+    // One-sample bursts between 450ms idle windows: race
+    for (u32 i = 0; i < 51; i++)
+        feed(model, i % 10 == 0 ? 70 : 2, irqs += 2);
+    freq = energy_decision_target(table, model, 3200000, 25, 50, &race);
+    KUNIT_EXPECT_TRUE(test, race);
+    KUNIT_EXPECT_GT(test, freq, 800000U);
+
+    // Continuous load with frequent wakeups: pace at the lowest sufficient OPP
+    init_prediction_model(model);
+    for (u32 i = 0; i < 50; i++)
+        feed(model, 60, irqs += 200);
+    freq = energy_decision_target(table, model, 3200000, 25, 50, &race);
+    KUNIT_EXPECT_FALSE(test, race);
+    KUNIT_EXPECT_EQ(test, freq, 800000U);
+}
+
+// One 50ms sample built the way the collector builds it, from cumulative times
+static u32 io_sample(iowait_boost_t *ib, struct cpu_times *times, u32 busy_ms, u32 iowait_ms,
+                     u32 new_irqs, u32 cap)
+{
+    struct cpu_times prev = *times;
+    cpu_metrics_t metrics = { 0 };
+
+    times->wall_us += 50000;
+    times->idle_us += (50 - busy_ms) * 1000;
+    times->iowait_us += iowait_ms * 1000;
+    times->irqs += new_irqs;
+    cpu_times_to_metrics(&prev, times, &metrics);
+    return iowait_boost_update(ib, &metrics, cap);
+}
+
+static void iowait_boost_test(struct kunit *test)
+{
+    iowait_boost_t *ib = kunit_kzalloc(test, sizeof(*ib), GFP_KERNEL);
+    struct cpu_times times = { 0 };
+    u32 boost;
+
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ib);
+    // Blocked on I/O for 3 samples, then 2 samples of completion processing at 70%
+    for (u32 cycle = 0; cycle < 6; cycle++) {
+        for (u32 i = 0; i < 3; i++)
+            io_sample(ib, &times, 2, 30, 5, 75);
+        io_sample(ib, &times, 35, 0, 100, 75);
+        io_sample(ib, &times, 35, 0, 100, 75);
+        io_sample(ib, &times, 1, 0, 5, 75);
+    }
+    KUNIT_EXPECT_EQ(test, ib->completions, 6U);
+    KUNIT_EXPECT_EQ(test, ib->completion_util >> IOWAIT_EWMA_SHIFT, 70U);
+
+    // Pre-raised while the next I/O is outstanding, held through the run
+    KUNIT_EXPECT_EQ(test, io_sample(ib, &times, 2, 30, 5, 75), 70U);
+    KUNIT_EXPECT_EQ(test, io_sample(ib, &times, 35, 0, 100, 75), 70U);
+    KUNIT_EXPECT_EQ(test, io_sample(ib, &times, 35, 0, 100, 75), 70U);
+    // Then decays once the run is over
+    boost = io_sample(ib, &times, 1, 0, 5, 75);
+    KUNIT_EXPECT_LT(test, boost, 70U);
+    KUNIT_EXPECT_LT(test, io_sample(ib, &times, 1, 0, 5, 75), boost);
+
+    KUNIT_EXPECT_EQ(test, io_sample(ib, &times, 2, 30, 5, 40), 40U);
+    KUNIT_EXPECT_EQ(test, io_sample(ib, &times, 2, 30, 5, 0), 0U);
+}
+
+static struct kunit_case target_test_cases[] = {
+    KUNIT_CASE(resolve_frequency_test),
+    KUNIT_CASE(target_frequency_proportional_test),
+    KUNIT_CASE(target_frequency_quantile_test),
+    KUNIT_CASE(thermal_budget_cap_test),
+    KUNIT_CASE(thermal_budget_observe_test),
+    KUNIT_CASE(energy_decision_test),
+    KUNIT_CASE(iowait_boost_test),
+    {}
+};
+
+static struct kunit_suite target_test_suite = {
+    .name = "predictive_cpufreq_target",
+    .test_cases = target_test_cases,
+};
+
+/* Metric collector */
+
+static void collector_deltas_test(struct kunit *test)
+{
+    struct cpu_times prev = { .wall_us = 1000000, .idle_us = 400000, .iowait_us = 10000, .irqs = 500 };
+    struct cpu_times now = { .wall_us = 1050000, .idle_us = 420000, .iowait_us = 15000, .irqs = 620 };
+    cpu_metrics_t metrics = { 0 };
+
+    cpu_times_to_metrics(&prev, &now, &metrics);
+    KUNIT_EXPECT_EQ(test, metrics.cpu_util, 60U);
+    KUNIT_EXPECT_EQ(test, metrics.iowait, 10U);
+    KUNIT_EXPECT_EQ(test, metrics.idle_time, 20000 * NSEC_PER_USEC);
+    KUNIT_EXPECT_EQ(test, metrics.irq_count, 620U);
+
+    // Idle accounting that runs ahead of the wall clock is clamped
+    now.idle_us = 500000;
+    cpu_times_to_metrics(&prev, &now, &metrics);
+    KUNIT_EXPECT_EQ(test, metrics.cpu_util, 0U);
+
+    cpu_times_to_metrics(&prev, &prev, &metrics);
+    KUNIT_EXPECT_EQ(test, metrics.cpu_util, 0U);
+    KUNIT_EXPECT_EQ(test, metrics.idle_time, 0ULL);
+}
+
+static void collector_counter_validity_test(struct kunit *test)
+{
+    KUNIT_EXPECT_TRUE(test, hw_counter_sample_valid(1000, 1000));
+    KUNIT_EXPECT_TRUE(test, hw_counter_sample_valid(1000, 950));
+    KUNIT_EXPECT_FALSE(test, hw_counter_sample_valid(1000, 949));
+    KUNIT_EXPECT_FALSE(test, hw_counter_sample_valid(1000, 0));
+}
+
+static struct kunit_case collector_test_cases[] = {
+    KUNIT_CASE(collector_deltas_test),
+    KUNIT_CASE(collector_counter_validity_test),
+    {}
+};
+
+static struct kunit_suite collector_test_suite = {
+    .name = "predictive_cpufreq_collector",
+    .test_cases = collector_test_cases,
+};
+
+/* Hot path benchmarks */
+
+// One governor sample without the cpufreq driver call
+static void bench_sample_test(struct kunit *test)
+{
+    struct cpufreq_policy *policy = alloc_policy(test, true);
+    prediction_model_t *model = alloc_model(test);
+    volatile u32 sink = 0;
+    u64 start, per_sample;
+
+    for (u32 i = 0; i < HISTORY_SIZE; i++)
+        feed(model, (i * 7) % 100, i * 10);
+    update_patterns(model);
+
+    start = ktime_get_ns();
+    for (u32 i = 0; i < BENCH_ITERATIONS; i++) {
+        feed(model, (i * 7) % 100, i * 10);
+        sink = calculate_target_frequency(policy, predict_cpu_utilization(model), model);
+    }
+    per_sample = div_u64(ktime_get_ns() - start, BENCH_ITERATIONS);
+    (void)sink;
+
+    kunit_info(test, "per-sample hot path: %llu ns\n", per_sample);
+    KUNIT_EXPECT_LE_MSG(test, per_sample, (u64)bench_sample_ns,
+                        "hot path regressed past bench_sample_ns");
+}
+
+static void bench_update_patterns_test(struct kunit *test)
+{
+    prediction_model_t *model = alloc_model(test);
+    u64 start, per_call;
+
+    for (u32 i = 0; i < HISTORY_SIZE; i++)
+        feed(model, (i % 20) * 5, i * 10);
+
+    start = ktime_get_ns();
+    for (u32 i = 0; i < 100; i++) {
+        feed(model, (i % 20) * 5, i * 10);
+        update_patterns(model);
+    }
+    per_call = div_u64(ktime_get_ns() - start, 100);
+
+    kunit_info(test, "update_patterns: %llu ns\n", per_call);
+    KUNIT_EXPECT_LE_MSG(test, per_call, (u64)bench_update_patterns_ns,
+                        "update_patterns regressed past bench_update_patterns_ns");
+}
+
+static struct kunit_case bench_test_cases[] = {
+    KUNIT_CASE(bench_sample_test),
+    KUNIT_CASE(bench_update_patterns_test),
+    {}
+};
+
+static struct kunit_suite bench_test_suite = {
+    .name = "predictive_cpufreq_bench",
+    .test_cases = bench_test_cases,
+};
+
+kunit_test_suites(&model_test_suite, &pattern_test_suite, &target_test_suite,
+                  &collector_test_suite, &bench_test_suite);
+
+#ifndef PREDICTIVE_KUNIT_IN_GOVERNOR
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("KUnit tests for the predictive cpufreq governor");
+#endif
@@ -1,2 +1,180 @@
-// Placeholder for synthetic workload generator for testing
-// Implement workload generation as needed for test scenarios
+// synthetic_workload.c - Bursty load with a simulated thermal zone
+//
+// Runs busy/idle bursts pinned to one CPU and integrates a first-order
+// thermal model driven by the frequency the governor picked. The simulated
+// temperature is written into a fake thermal zone, so the governor can be
+// loaded with thermal_root pointing at it:
+//
+//   ./synthetic_workload -t /tmp/fakezone -c 2 &
+//   insmod predictive-cpufreq.ko thermal_root=/tmp/fakezone
+//
+// Above the trip point the platform is modelled as throttling to
+// throttle_pct of the chosen frequency; the per-second report shows the
+// work that survives, which is what thermal capping should maximize.
+#define _GNU_SOURCE
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TICK_MS 10
+
+struct thermal_sim {
+    double temp_c;
+    double ambient_c;
+    double trip_c;
+    double tau_s;            // Time constant of the heatsink
+    double full_rise_c;      // Steady-state rise at max_freq and 100% load
+    double idle_rise_c;      // Steady-state rise when idle
+    double throttle_pct;     // Frequency left while above trip
+};
+
+static int read_khz(const char *path, unsigned long *khz)
+{
+    FILE *f = fopen(path, "r");
+    int ok;
+    if (!f)
+        return -errno;
+    ok = fscanf(f, "%lu", khz) == 1;
+    fclose(f);
+    return ok ? 0 : -EINVAL;
+}
+
+static int write_millicelsius(const char *dir, const char *name, double celsius)
+{
+    char path[256], tmp[272];
+    FILE *f;
+    // Write and rename so the governor never reads a partial value
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    f = fopen(tmp, "w");
+    if (!f)
+        return -errno;
+    fprintf(f, "%ld\n", (long)(celsius * 1000));
+    fclose(f);
+    return rename(tmp, path) ? -errno : 0;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Spin for ms, returning loop iterations as a measure of work done
+static unsigned long busy(double ms)
+{
+    double end = now_s() + ms / 1000;
+    volatile unsigned long n = 0;
+    while (now_s() < end)
+        for (int i = 0; i < 1000; i++)
+            n++;
+    return n;
+}
+
+static void thermal_step(struct thermal_sim *sim, double freq_ratio, double load, double dt)
+{
+    double power = freq_ratio * freq_ratio * freq_ratio * load;
+    double target = sim->ambient_c + sim->idle_rise_c + (sim->full_rise_c - sim->idle_rise_c) * power;
+    sim->temp_c += (target - sim->temp_c) * dt / sim->tau_s;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s -t zone_dir [-c cpu] [-b burst_ms] [-i idle_ms] [-d seconds]\n"
+            "          [-f cpufreq_dir] [-T trip_c]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    struct thermal_sim sim = {
+        .temp_c = 45, .ambient_c = 35, .trip_c = 90, .tau_s = 8,
+        .full_rise_c = 75, .idle_rise_c = 10, .throttle_pct = 50,
+    };
+    const char *zone = NULL;
+    char cpufreq_dir[128] = "";
+    char cur_path[192], max_path[192];
+    int cpu = 0, burst_ms = 2000, idle_ms = 1000, duration = 60, opt;
+    unsigned long max_khz, cur_khz;
+    double work = 0, total_work = 0, second = 0, phase = 0;
+    int busy_phase = 1;
+    cpu_set_t set;
+
+    while ((opt = getopt(argc, argv, "t:c:b:i:d:f:T:")) != -1) {
+        switch (opt) {
+        case 't': zone = optarg; break;
+        case 'c': cpu = atoi(optarg); break;
+        case 'b': burst_ms = atoi(optarg); break;
+        case 'i': idle_ms = atoi(optarg); break;
+        case 'd': duration = atoi(optarg); break;
+        case 'f': snprintf(cpufreq_dir, sizeof(cpufreq_dir), "%s", optarg); break;
+        case 'T': sim.trip_c = atof(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (!zone) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!*cpufreq_dir)
+        snprintf(cpufreq_dir, sizeof(cpufreq_dir), "/sys/devices/system/cpu/cpu%d/cpufreq", cpu);
+    snprintf(cur_path, sizeof(cur_path), "%s/scaling_cur_freq", cpufreq_dir);
+    snprintf(max_path, sizeof(max_path), "%s/cpuinfo_max_freq", cpufreq_dir);
+    if (read_khz(max_path, &max_khz) || !max_khz) {
+        fprintf(stderr, "Cannot read %s\n", max_path);
+        return 1;
+    }
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set))
+        perror("sched_setaffinity");
+    mkdir(zone, 0755);
+    if (write_millicelsius(zone, "trip_point_0_temp", sim.trip_c) ||
+        write_millicelsius(zone, "temp", sim.temp_c)) {
+        fprintf(stderr, "Cannot write fake thermal zone in %s\n", zone);
+        return 1;
+    }
+
+    printf("time_s temp_c freq_khz work\n");
+    for (int tick = 0; tick < duration * 1000 / TICK_MS; tick++) {
+        double ratio, effective = 1;
+        if (read_khz(cur_path, &cur_khz))
+            cur_khz = max_khz;
+        ratio = (double)cur_khz / max_khz;
+        if (sim.temp_c >= sim.trip_c) {
+            effective = sim.throttle_pct / 100;
+            ratio *= effective;
+        }
+
+        if (busy_phase) {
+            work += busy(TICK_MS) * effective;
+        } else {
+            usleep(TICK_MS * 1000);
+        }
+        thermal_step(&sim, ratio, busy_phase ? 1.0 : 0.0, TICK_MS / 1000.0);
+        write_millicelsius(zone, "temp", sim.temp_c);
+
+        phase += TICK_MS;
+        if (phase >= (busy_phase ? burst_ms : idle_ms)) {
+            busy_phase = !busy_phase;
+            phase = 0;
+        }
+        second += TICK_MS;
+        if (second >= 1000) {
+            printf("%d %.1f %lu %.0f\n", (tick + 1) * TICK_MS / 1000, sim.temp_c, cur_khz, work);
+            fflush(stdout);
+            total_work += work;
+            work = 0;
+            second = 0;
+        }
+    }
+    printf("total_work %.0f\n", total_work);
+    return 0;
+}
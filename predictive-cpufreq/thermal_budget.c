@@ -0,0 +1,206 @@
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/err.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/math64.h>
+#include <linux/timekeeping.h>
+#include "thermal_budget.h"
+#include "target_frequency.h"
+
+/*
+ * Thermal- and power-budget-aware capping. Running a burst at max_freq
+ * until the platform throttles gives worse sustained throughput than a
+ * steady lower OPP. The governor learns how fast the zone heats at each
+ * frequency, predicts the time to the trip point for the planned frequency,
+ * and picks the highest frequency whose thermal headroom lasts for the
+ * predicted burst.
+ *
+ * Readings come from files under configurable roots, so a fake tree can
+ * stand in for sysfs (see tests/synthetic_workload.c):
+ *   <thermal_root>/temp                          millidegree C
+ *   <thermal_root>/trip_point_0_temp             millidegree C
+ *   <powercap_root>/energy_uj                    optional
+ *   <powercap_root>/constraint_0_power_limit_uw  optional
+ */
+static char *thermal_root = "";
+module_param(thermal_root, charp, 0444);
+MODULE_PARM_DESC(thermal_root, "Thermal zone directory of the CPU package sensor (e.g. /sys/class/thermal/thermal_zone0), empty to disable");
+
+static char *powercap_root = "";
+module_param(powercap_root, charp, 0444);
+MODULE_PARM_DESC(powercap_root, "Powercap zone directory (e.g. /sys/class/powercap/intel-rapl:0), empty to disable");
+
+static unsigned int thermal_trip_mc;
+module_param(thermal_trip_mc, uint, 0444);
+MODULE_PARM_DESC(thermal_trip_mc, "Throttle temperature in millidegree C, 0 to read trip_point_0_temp");
+
+static thermal_snapshot_t thermal_state;
+static u64 last_energy_uj;
+static u64 last_energy_ns;
+static u64 last_refresh_ns;
+static DEFINE_MUTEX(thermal_read_lock);
+static DEFINE_SPINLOCK(thermal_state_lock);
+
+static int read_sysfs_value(const char *root, const char *name, s64 *value)
+{
+    char path[128], buf[32];
+    struct file *file;
+    loff_t pos = 0;
+    ssize_t len;
+
+    if (!root || !*root)
+        return -ENOENT;
+    snprintf(path, sizeof(path), "%s/%s", root, name);
+    file = filp_open(path, O_RDONLY, 0);
+    if (IS_ERR(file))
+        return PTR_ERR(file);
+    len = kernel_read(file, buf, sizeof(buf) - 1, &pos);
+    filp_close(file, NULL);
+    if (len <= 0)
+        return -EIO;
+    buf[len] = '\0';
+    return kstrtos64(strim(buf), 10, value);
+}
+
+// Sleeps; called outside the per-policy locks and rate limited machine-wide
+static void thermal_budget_refresh(u64 now)
+{
+    thermal_snapshot_t state;
+    s64 temp, trip, energy, limit;
+    unsigned long flags;
+
+    spin_lock_irqsave(&thermal_state_lock, flags);
+    state = thermal_state;
+    spin_unlock_irqrestore(&thermal_state_lock, flags);
+
+    state.valid = read_sysfs_value(thermal_root, "temp", &temp) == 0;
+    if (thermal_trip_mc)
+        trip = thermal_trip_mc;
+    else if (read_sysfs_value(thermal_root, "trip_point_0_temp", &trip))
+        state.valid = false;
+    if (state.valid) {
+        state.temp_mc = (s32)temp;
+        state.trip_mc = (s32)trip;
+        state.timestamp = now;
+    }
+
+    state.power_mw = 0;
+    state.power_limit_mw = 0;
+    if (!read_sysfs_value(powercap_root, "energy_uj", &energy)) {
+        // The counter wraps; skip the interval in which it did
+        if (last_energy_ns && (u64)energy >= last_energy_uj && now > last_energy_ns)
+            state.power_mw = (u32)div64_u64(((u64)energy - last_energy_uj) * 1000000, now - last_energy_ns);
+        last_energy_uj = energy;
+        last_energy_ns = now;
+        if (!read_sysfs_value(powercap_root, "constraint_0_power_limit_uw", &limit))
+            state.power_limit_mw = (u32)div_u64(limit, 1000);
+    }
+
+    spin_lock_irqsave(&thermal_state_lock, flags);
+    thermal_state = state;
+    spin_unlock_irqrestore(&thermal_state_lock, flags);
+}
+
+// Latest readings, refreshed from sysfs when older than THERMAL_REFRESH_MS
+void thermal_budget_read(thermal_snapshot_t *snapshot)
+{
+    u64 now = ktime_get_ns();
+    unsigned long flags;
+
+    if (now - READ_ONCE(last_refresh_ns) >= THERMAL_REFRESH_MS * NSEC_PER_MSEC &&
+        mutex_trylock(&thermal_read_lock)) {
+        WRITE_ONCE(last_refresh_ns, now);
+        thermal_budget_refresh(now);
+        mutex_unlock(&thermal_read_lock);
+    }
+
+    spin_lock_irqsave(&thermal_state_lock, flags);
+    *snapshot = thermal_state;
+    spin_unlock_irqrestore(&thermal_state_lock, flags);
+}
+
+static int freq_bucket(u32 freq, u32 max_freq)
+{
+    if (!max_freq)
+        return 0;
+    return clamp((int)div_u64((u64)freq * THERMAL_BUCKETS, max_freq + 1), 0, THERMAL_BUCKETS - 1);
+}
+
+/*
+ * Attribute the temperature change since the last reading to the frequency
+ * that ran over it. Readings refresh less often than samples, so the
+ * frequencies of the samples in between are averaged; cur_freq is the one
+ * that ran up to this sample.
+ */
+void thermal_budget_observe(thermal_policy_t *tp, const thermal_snapshot_t *snapshot,
+                            u32 cur_freq, u32 max_freq)
+{
+    if (!snapshot->valid)
+        return;
+
+    tp->freq_sum += cur_freq;
+    tp->freq_samples++;
+    if (snapshot->timestamp == tp->last_timestamp)
+        return;
+
+    if (tp->last_timestamp && snapshot->timestamp > tp->last_timestamp) {
+        u64 dt_ms = div_u64(snapshot->timestamp - tp->last_timestamp, NSEC_PER_MSEC);
+        int bucket = freq_bucket((u32)div_u64(tp->freq_sum, tp->freq_samples), max_freq);
+
+        if (dt_ms) {
+            s32 rate = (s32)div_s64((s64)(snapshot->temp_mc - tp->last_temp_mc) * 1000, dt_ms);
+
+            tp->heat_rate[bucket] = tp->learned[bucket] ?
+                                    (tp->heat_rate[bucket] * 7 + rate) / 8 : rate;
+            tp->learned[bucket] = true;
+        }
+    }
+    tp->last_temp_mc = snapshot->temp_mc;
+    tp->last_timestamp = snapshot->timestamp;
+    tp->freq_sum = 0;
+    tp->freq_samples = 0;
+}
+
+/*
+ * Highest frequency up to target_freq that keeps the zone below its trip
+ * point for burst_ms, judging by the heating rate learned at each bucket.
+ * Buckets that were never observed are trusted. Above the power limit the
+ * frequency is not raised.
+ */
+u32 thermal_budget_cap(thermal_policy_t *tp, const thermal_snapshot_t *snapshot,
+                       struct cpufreq_policy *policy, u32 target_freq, u32 burst_ms)
+{
+    u32 max_freq = policy->cpuinfo.max_freq;
+    u32 cap = target_freq;
+    s32 headroom;
+
+    if (snapshot->power_limit_mw &&
+        snapshot->power_mw * 100 >= snapshot->power_limit_mw * THERMAL_POWER_HEADROOM)
+        cap = min(cap, max(policy->cur, policy->cpuinfo.min_freq));
+
+    if (snapshot->valid && snapshot->trip_mc > 0) {
+        headroom = snapshot->trip_mc - snapshot->temp_mc;
+        for (int bucket = freq_bucket(cap, max_freq); bucket >= 0; bucket--) {
+            s32 rate = tp->heat_rate[bucket];
+            u32 bucket_max = (u32)div_u64((u64)max_freq * (bucket + 1), THERMAL_BUCKETS);
+
+            // Fits if it cools, is unknown, or reaches the trip only after the burst
+            if (!tp->learned[bucket] || rate <= 0 ||
+                (headroom > 0 && (u64)headroom * 1000 >= (u64)rate * burst_ms)) {
+                cap = min(cap, bucket_max);
+                break;
+            }
+            if (bucket == 0)
+                cap = policy->cpuinfo.min_freq;
+        }
+    }
+
+    if (cap >= target_freq)
+        return target_freq;
+    tp->capped++;
+    cap = max(cap, policy->cpuinfo.min_freq);
+    return resolve_frequency(policy, cap, CPUFREQ_RELATION_H);
+}
@@ -0,0 +1,38 @@
+#ifndef THERMAL_BUDGET_H
+#define THERMAL_BUDGET_H
+
+#include <linux/cpufreq.h>
+#include "predictive_model.h"
+
+#define THERMAL_BUCKETS 8          // Frequency buckets for learned heating rates
+#define THERMAL_REFRESH_MS 100     // Minimum interval between sysfs reads
+#define THERMAL_POWER_HEADROOM 95  // Hold frequency above this % of the power limit
+
+// Machine-wide thermal/power readings
+typedef struct {
+    bool valid;                    // Temperature and trip point were read
+    s32 temp_mc;                   // Zone temperature (millidegree C)
+    s32 trip_mc;                   // Throttle trip point (millidegree C)
+    u32 power_mw;                  // Package power, 0 if unknown
+    u32 power_limit_mw;            // Package power limit, 0 if none
+    u64 timestamp;                 // ktime ns of the temperature reading
+} thermal_snapshot_t;
+
+// Per-policy heating model: temperature slope at each frequency bucket
+typedef struct {
+    s32 heat_rate[THERMAL_BUCKETS];     // Temperature change (millidegree C/s)
+    bool learned[THERMAL_BUCKETS];
+    s32 last_temp_mc;
+    u64 last_timestamp;
+    u64 freq_sum;                       // Sample frequencies since last_timestamp
+    u32 freq_samples;
+    u32 capped;                         // Samples where the budget lowered the target
+} thermal_policy_t;
+
+void thermal_budget_read(thermal_snapshot_t *snapshot);
+void thermal_budget_observe(thermal_policy_t *tp, const thermal_snapshot_t *snapshot,
+                            u32 cur_freq, u32 max_freq);
+u32 thermal_budget_cap(thermal_policy_t *tp, const thermal_snapshot_t *snapshot,
+                       struct cpufreq_policy *policy, u32 target_freq, u32 burst_ms);
+
+#endif // THERMAL_BUDGET_H
@@ -1,57 +1,491 @@
 // predictive_cpu_freq.c
 // Predictive CPU Frequency Scaling Skeleton for RISC/Linux
-// Compile with: gcc predictive_cpu_freq.c -o predictive_cpu_freq
+// Compile with: gcc -O2 predictive_cpu_freq.c -o predictive_cpu_freq
+//
+// The control loop runs on absolute deadlines (timerfd, or clock_nanosleep
+// with TIMER_ABSTIME), so work time never shifts the schedule. Each period
+// it reports wake-up latency past the deadline and periods missed outright.
+// With -r the daemon reads and writes a fake sysfs/procfs tree instead of
+// the real one; -g creates such a tree with N CPUs for scale tests, with
+// random per-CPU load every period so frequency writes are exercised too.
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
 
-#define CPU_FREQ_PATH "/sys/devices/system/cpu/cpu0/cpufreq/scaling_setspeed"
+#define CPUFREQ_DIR "/sys/devices/system/cpu/cpu%d/cpufreq"
 #define STAT_PATH "/proc/stat"
 #define HISTORY 10
+#define MAX_CPUS 4096
+#define STAT_BUF_SIZE (256 * MAX_CPUS)
+#define NSEC_PER_MSEC 1000000LL
+#define NSEC_PER_SEC 1000000000LL
 
-// Collect CPU usage data
-double get_cpu_usage();
+struct cpu_state {
+    unsigned long long busy, total;     // Cumulative /proc/stat ticks at the last sample
+    double usage_history[HISTORY];
+    int min_freq, max_freq;             // kHz
+    int last_freq;
+    int setspeed_fd;                    // -1 if the CPU can't be controlled
+    int online;                         // Listed in the latest /proc/stat
+};
+
+struct loop_stats {
+    long long *latency_ns;              // Wake-up past deadline, this report window
+    int count, capacity;
+    long long overruns;                 // Periods missed entirely
+    long long work_ns;                  // Time spent sampling and predicting
+    long long iterations;
+};
+
+struct options {
+    int interval_ms;
+    const char *root;                   // Prefix for /sys and /proc, "" for the real ones
+    int fifo_priority;                  // 0 = normal scheduling
+    int use_nanosleep;                  // clock_nanosleep instead of timerfd
+    int duration_s;                     // 0 = until SIGINT/SIGTERM
+    int report_s;
+    int generate_cpus;                  // Create a fake tree with this many CPUs first
+};
+
+static volatile sig_atomic_t stop;
+static int fake_root;                   // Files are plain files, not sysfs attributes
+static struct cpu_state *cpus;
+static int ncpus;                       // Highest CPU ID + 1; cpus[] is indexed by ID
+static int stat_fd = -1;
+static char *stat_buf;
+static long long freq_writes;           // scaling_setspeed writes, this report window
+
+// Generated tree: per-CPU load advanced every period so targets keep changing
+static int fake_cpus;
+static int fake_stat_fd = -1;
+static char *fake_stat_buf;
+static unsigned long long *fake_busy, *fake_idle;
+static unsigned int fake_seed = 1;
+
+// Collect CPU usage data for every CPU in /proc/stat
+int get_cpu_usage(void);
 
 // Predict next workload (simple moving average)
 double predict_next(double *history, int len);
 
 // Set CPU frequency
-int set_cpu_freq(int freq);
-
-int main() {
-    double usage_history[HISTORY] = {0};
-    int idx = 0;
-    while (1) {
-        double usage = get_cpu_usage();
-        usage_history[idx % HISTORY] = usage;
-        double predicted = predict_next(usage_history, HISTORY);
-        int freq = (int)(predicted * 1000); // Example mapping
-        set_cpu_freq(freq);
-        idx++;
-        sleep(1); // 1 second interval
+int set_cpu_freq(struct cpu_state *cpu, int freq);
+
+static void handle_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void ns_to_timespec(long long ns, struct timespec *ts) {
+    ts->tv_sec = ns / NSEC_PER_SEC;
+    ts->tv_nsec = ns % NSEC_PER_SEC;
+}
+
+static int read_int_file(const char *path, int *value) {
+    FILE *f = fopen(path, "r");
+    int ok;
+    if (!f) return -1;
+    ok = fscanf(f, "%d", value) == 1;
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+static int write_file(const char *path, const char *text) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    fputs(text, f);
+    return fclose(f);
+}
+
+static int mkdir_p(const char *path) {
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s", path);
+    for (char *p = buf + 1; *p; p++) {
+        if (*p == '/') {
+            *p = 0;
+            if (mkdir(buf, 0755) && errno != EEXIST) return -1;
+            *p = '/';
+        }
+    }
+    return mkdir(buf, 0755) && errno != EEXIST ? -1 : 0;
+}
+
+// Rewrite the generated /proc/stat, first advancing each CPU by one period of random load
+static int write_fake_stat(int advance) {
+    int len = snprintf(fake_stat_buf, STAT_BUF_SIZE, "cpu  0 0 0 0 0 0 0 0 0 0\n");
+
+    for (int i = 0; i < fake_cpus && len < STAT_BUF_SIZE - 128; i++) {
+        if (advance) {
+            unsigned int busy;
+            fake_seed = fake_seed * 1103515245 + 12345;
+            busy = (fake_seed >> 16) % 101;
+            fake_busy[i] += busy;
+            fake_idle[i] += 100 - busy;
+        }
+        len += snprintf(fake_stat_buf + len, STAT_BUF_SIZE - len, "cpu%d %llu 0 0 %llu 0 0 0 0 0 0\n",
+                        i, fake_busy[i], fake_idle[i]);
+    }
+    len += snprintf(fake_stat_buf + len, STAT_BUF_SIZE - len, "intr 0\nctxt 0\n");
+    // Counters only grow, so the file never shrinks
+    return pwrite(fake_stat_fd, fake_stat_buf, len, 0) == len ? 0 : -1;
+}
+
+// Fake /proc/stat and cpufreq files for n CPUs under root
+static int generate_fake_tree(const char *root, int n) {
+    char path[512], text[64];
+
+    snprintf(path, sizeof(path), "%s/proc", root);
+    if (mkdir_p(path)) return -1;
+    snprintf(path, sizeof(path), "%s" STAT_PATH, root);
+    fake_stat_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    fake_stat_buf = malloc(STAT_BUF_SIZE);
+    fake_busy = calloc(n, sizeof(*fake_busy));
+    fake_idle = calloc(n, sizeof(*fake_idle));
+    if (fake_stat_fd < 0 || !fake_stat_buf || !fake_busy || !fake_idle) return -1;
+    fake_cpus = n;
+    if (write_fake_stat(0)) return -1;
+    snprintf(path, sizeof(path), "%s/sys/devices/system/cpu", root);
+    if (mkdir_p(path)) return -1;
+    snprintf(path, sizeof(path), "%s/sys/devices/system/cpu/present", root);
+    snprintf(text, sizeof(text), "0-%d\n", n - 1);
+    write_file(path, text);
+
+    for (int i = 0; i < n; i++) {
+        snprintf(path, sizeof(path), "%s" CPUFREQ_DIR, root, i);
+        if (mkdir_p(path)) return -1;
+        snprintf(path, sizeof(path), "%s" CPUFREQ_DIR "/cpuinfo_min_freq", root, i);
+        write_file(path, "800000\n");
+        snprintf(path, sizeof(path), "%s" CPUFREQ_DIR "/cpuinfo_max_freq", root, i);
+        write_file(path, "3200000\n");
+        snprintf(path, sizeof(path), "%s" CPUFREQ_DIR "/scaling_setspeed", root, i);
+        snprintf(text, sizeof(text), "%d\n", 800000);
+        write_file(path, text);
+    }
+    return 0;
+}
+
+// Highest CPU ID + 1 from /proc/stat, which skips offline CPUs
+static int max_stat_cpu(void) {
+    int n = 0;
+    for (char *line = stat_buf; (line = strstr(line, "\ncpu")) != NULL; line++)
+        if (line[4] >= '0' && line[4] <= '9') {
+            int id = atoi(line + 4);
+            if (id + 1 > n) n = id + 1;
+        }
+    return n;
+}
+
+// Highest CPU ID + 1 from the present mask ("0-7" or "0,2-3"), 0 if unreadable
+static int max_present_cpu(const char *root) {
+    char path[512], buf[256];
+    char *last;
+    ssize_t len;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/sys/devices/system/cpu/present", root);
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0) return 0;
+    buf[len] = 0;
+    last = buf;
+    for (char *p = buf; *p; p++)
+        if (*p == '-' || *p == ',') last = p + 1;
+    return atoi(last) + 1;
+}
+
+static int read_stat(void) {
+    ssize_t len = pread(stat_fd, stat_buf, STAT_BUF_SIZE - 1, 0);
+    if (len < 0) return -1;
+    stat_buf[len] = 0;
+    return 0;
+}
+
+static int init_cpus(const char *root) {
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s" STAT_PATH, root);
+    stat_fd = open(path, O_RDONLY);
+    stat_buf = malloc(STAT_BUF_SIZE);
+    if (stat_fd < 0 || !stat_buf || read_stat()) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return -1;
     }
+    ncpus = max_present_cpu(root);
+    if (ncpus < max_stat_cpu())
+        ncpus = max_stat_cpu();
+    if (ncpus <= 0 || ncpus > MAX_CPUS) return -1;
+    cpus = calloc(ncpus, sizeof(*cpus));
+    if (!cpus) return -1;
+
+    for (int i = 0; i < ncpus; i++) {
+        struct cpu_state *cpu = &cpus[i];
+        snprintf(path, sizeof(path), "%s" CPUFREQ_DIR "/cpuinfo_min_freq", root, i);
+        read_int_file(path, &cpu->min_freq);
+        snprintf(path, sizeof(path), "%s" CPUFREQ_DIR "/cpuinfo_max_freq", root, i);
+        read_int_file(path, &cpu->max_freq);
+        // scaling_setspeed only exists under the userspace governor
+        snprintf(path, sizeof(path), "%s" CPUFREQ_DIR "/scaling_setspeed", root, i);
+        cpu->setspeed_fd = open(path, O_WRONLY);
+    }
+    get_cpu_usage();    // Baseline for the first delta
     return 0;
 }
 
-double get_cpu_usage() {
-    // TODO: Read /proc/stat and calculate CPU usage
-    return 0.5; // Placeholder
+static void set_realtime(int priority) {
+    struct sched_param param = { .sched_priority = priority };
+    // Page faults in the loop would show up as latency
+    if (mlockall(MCL_CURRENT | MCL_FUTURE))
+        perror("mlockall");
+    if (sched_setscheduler(0, SCHED_FIFO, &param))
+        perror("sched_setscheduler");
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static void record_latency(struct loop_stats *stats, long long latency) {
+    if (stats->count < stats->capacity)
+        stats->latency_ns[stats->count++] = latency;
+}
+
+static void report(struct loop_stats *stats, double elapsed_s, struct rusage *start) {
+    struct rusage ru;
+    double cpu_s;
+    long long *v = stats->latency_ns;
+    int n = stats->count;
+
+    getrusage(RUSAGE_SELF, &ru);
+    cpu_s = (ru.ru_utime.tv_sec - start->ru_utime.tv_sec) + (ru.ru_stime.tv_sec - start->ru_stime.tv_sec) +
+            ((ru.ru_utime.tv_usec - start->ru_utime.tv_usec) + (ru.ru_stime.tv_usec - start->ru_stime.tv_usec)) / 1e6;
+    qsort(v, n, sizeof(*v), cmp_ll);
+    printf("cpus %d iterations %lld overruns %lld work_avg %.1f us writes %lld cpu %.2f%% "
+           "wakeup_latency p50 %.1f p99 %.1f max %.1f us\n",
+           ncpus, stats->iterations, stats->overruns,
+           stats->iterations ? stats->work_ns / 1e3 / stats->iterations : 0.0, freq_writes,
+           elapsed_s > 0 ? 100.0 * cpu_s / elapsed_s : 0.0,
+           n ? v[n / 2] / 1e3 : 0.0, n ? v[(n * 99) / 100] / 1e3 : 0.0, n ? v[n - 1] / 1e3 : 0.0);
+    fflush(stdout);
+    stats->count = 0;
+    stats->overruns = 0;
+    stats->work_ns = 0;
+    stats->iterations = 0;
+    freq_writes = 0;
+    *start = ru;
+}
+
+static void control_step(void) {
+    get_cpu_usage();
+    for (int i = 0; i < ncpus; i++) {
+        struct cpu_state *cpu = &cpus[i];
+        if (!cpu->online) continue;
+        double predicted = predict_next(cpu->usage_history, HISTORY);
+        int freq = cpu->min_freq + (int)(predicted * (cpu->max_freq - cpu->min_freq));
+        set_cpu_freq(cpu, freq);
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-i interval_ms] [-r root] [-g ncpus] [-f priority] [-n] [-d seconds] [-s report_s]\n"
+            "  -i  control period, 1ms and up (default 1000)\n"
+            "  -r  read /proc and /sys under this root (fake tree)\n"
+            "  -g  create a fake tree with ncpus CPUs under the root first; its load\n"
+            "      changes every period (the rewrite counts in cpu%%, not work_avg)\n"
+            "  -f  run SCHED_FIFO at this priority with memory locked\n"
+            "  -n  use clock_nanosleep(TIMER_ABSTIME) instead of timerfd\n"
+            "  -d  stop after this many seconds\n"
+            "  -s  report loop statistics every this many seconds (default 10)\n", prog);
+}
+
+int main(int argc, char **argv) {
+    struct options opt = { .interval_ms = 1000, .root = "", .report_s = 10 };
+    struct loop_stats stats = { 0 };
+    struct rusage ru_start;
+    long long period, deadline, start, last_report;
+    int tfd = -1, c;
+
+    while ((c = getopt(argc, argv, "i:r:g:f:nd:s:h")) != -1) {
+        switch (c) {
+        case 'i': opt.interval_ms = atoi(optarg); break;
+        case 'r': opt.root = optarg; break;
+        case 'g': opt.generate_cpus = atoi(optarg); break;
+        case 'f': opt.fifo_priority = atoi(optarg); break;
+        case 'n': opt.use_nanosleep = 1; break;
+        case 'd': opt.duration_s = atoi(optarg); break;
+        case 's': opt.report_s = atoi(optarg); break;
+        default: usage(argv[0]); return c == 'h' ? 0 : 1;
+        }
+    }
+    if (opt.interval_ms < 1 || opt.report_s < 1 || (opt.generate_cpus && !*opt.root)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (opt.generate_cpus && (opt.generate_cpus > MAX_CPUS || generate_fake_tree(opt.root, opt.generate_cpus))) {
+        fprintf(stderr, "Cannot create fake tree under %s\n", opt.root);
+        return 1;
+    }
+    fake_root = *opt.root != 0;
+    if (init_cpus(opt.root))
+        return 1;
+
+    stats.capacity = (int)((long long)opt.report_s * 1000 / opt.interval_ms) + 1;
+    stats.latency_ns = malloc(stats.capacity * sizeof(*stats.latency_ns));
+    if (!stats.latency_ns)
+        return 1;
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    if (opt.fifo_priority)
+        set_realtime(opt.fifo_priority);
+
+    period = opt.interval_ms * NSEC_PER_MSEC;
+    start = now_ns();
+    deadline = start + period;
+    last_report = start;
+    getrusage(RUSAGE_SELF, &ru_start);
+
+    if (!opt.use_nanosleep) {
+        struct itimerspec its = { 0 };
+        tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        ns_to_timespec(deadline, &its.it_value);
+        ns_to_timespec(period, &its.it_interval);
+        if (tfd < 0 || timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL)) {
+            perror("timerfd");
+            opt.use_nanosleep = 1;
+        }
+    }
+
+    while (!stop) {
+        long long woke, work_start;
+
+        if (opt.use_nanosleep) {
+            struct timespec ts;
+            ns_to_timespec(deadline, &ts);
+            if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+                continue;
+            woke = now_ns();
+            // Skip periods the previous iteration ran over instead of bunching up
+            if (woke - deadline >= period) {
+                long long missed = (woke - deadline) / period;
+                stats.overruns += missed;
+                deadline += missed * period;
+            }
+        } else {
+            uint64_t expirations;
+            if (read(tfd, &expirations, sizeof(expirations)) != sizeof(expirations))
+                continue;
+            woke = now_ns();
+            stats.overruns += expirations - 1;
+            deadline += (long long)(expirations - 1) * period;
+        }
+        record_latency(&stats, woke - deadline);
+        // Stands in for the kernel updating /proc/stat; not part of the daemon's work
+        if (fake_cpus)
+            write_fake_stat(1);
+
+        work_start = now_ns();
+        control_step();
+        stats.work_ns += now_ns() - work_start;
+        stats.iterations++;
+        deadline += period;
+
+        if (woke - last_report >= opt.report_s * NSEC_PER_SEC) {
+            report(&stats, (woke - last_report) / 1e9, &ru_start);
+            last_report = woke;
+        }
+        if (opt.duration_s && woke - start >= opt.duration_s * NSEC_PER_SEC)
+            break;
+    }
+    if (stats.iterations)
+        report(&stats, (now_ns() - last_report) / 1e9, &ru_start);
+    return 0;
+}
+
+// strtoull and sscanf dominate the loop at 1024 CPUs; /proc/stat is plain decimal
+static unsigned long long parse_ull(char **p) {
+    unsigned long long v = 0;
+    char *s = *p;
+    while (*s == ' ') s++;
+    while (*s >= '0' && *s <= '9') v = v * 10 + (unsigned long long)(*s++ - '0');
+    *p = s;
+    return v;
+}
+
+int get_cpu_usage(void) {
+    char *line = stat_buf;
+
+    if (read_stat()) return -1;
+    for (int i = 0; i < ncpus; i++)
+        cpus[i].online = 0;
+    while ((line = strstr(line, "\ncpu")) != NULL) {
+        unsigned long long v[8], busy, total = 0;
+        struct cpu_state *c;
+        char *p = line + 4;
+        int cpu;
+
+        line++;
+        if (*p < '0' || *p > '9') continue;
+        cpu = (int)parse_ull(&p);
+        if (cpu >= ncpus) continue;
+        // user nice system idle iowait irq softirq steal; idle and iowait are not busy
+        for (int i = 0; i < 8; i++) {
+            v[i] = parse_ull(&p);
+            total += v[i];
+        }
+        busy = total - v[3] - v[4];
+        c = &cpus[cpu];
+        c->online = 1;
+        // Counters can step back across hotplug; treat that period as idle and rebase
+        double usage = 0.0;
+        if (total > c->total && busy >= c->busy)
+            usage = (double)(busy - c->busy) / (total - c->total);
+        if (usage > 1.0) usage = 1.0;
+        memmove(c->usage_history + 1, c->usage_history, (HISTORY - 1) * sizeof(double));
+        c->usage_history[0] = usage;
+        c->busy = busy;
+        c->total = total;
+    }
+    return 0;
 }
 
 double predict_next(double *history, int len) {
-    // TODO: Implement moving average or other predictive model
     double sum = 0;
     for (int i = 0; i < len; i++) sum += history[i];
     return sum / len;
 }
 
-int set_cpu_freq(int freq) {
-    // TODO: Write frequency to scaling_setspeed
-    FILE *f = fopen(CPU_FREQ_PATH, "w");
-    if (!f) return -1;
-    fprintf(f, "%d", freq);
-    fclose(f);
+int set_cpu_freq(struct cpu_state *cpu, int freq) {
+    char buf[16];
+    int len;
+    // Writes are the expensive part; skip unchanged targets
+    if (cpu->setspeed_fd < 0 || freq == cpu->last_freq) return 0;
+    len = snprintf(buf, sizeof(buf), "%d", freq);
+    if (pwrite(cpu->setspeed_fd, buf, len, 0) != len) return -1;
+    if (fake_root && ftruncate(cpu->setspeed_fd, len)) return -1;
+    cpu->last_freq = freq;
+    freq_writes++;
     return 0;
 }